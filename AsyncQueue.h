@@ -0,0 +1,218 @@
+// ----------------------------
+// projects/deque/AsyncQueue.h
+// ----------------------------
+
+#ifndef AsyncQueue_h
+#define AsyncQueue_h
+
+// Needs C++20 coroutines
+
+#include <algorithm>  // min
+#include <coroutine>  // coroutine_handle
+#include <cstddef>    // size_t
+#include <functional> // function
+#include <iterator>   // back_inserter
+#include <memory>     // allocator, allocator_traits
+#include <optional>   // optional
+#include <utility>    // forward, move
+#include <vector>     // vector
+
+#include "Deque.h"
+
+/**
+ * A first in, first out queue that coroutines can wait on
+ * Items that nobody is waiting for sit in a MyDeque, and suspended consumers
+ * wait their turn in a second MyDeque, so co_await pop() never blocks a thread
+ * Each push_back hands its item straight to the longest waiting consumer,
+ * if there is one, and resumes it either inline or through the scheduler
+ * With inline resumption the consumer runs inside push_back, before it returns
+ * Consumers still waiting when the queue is destroyed are never resumed
+ * Meant for one thread, like the event loop driving the coroutines
+ */
+template<typename T, typename A = std::allocator<T> >
+class AsyncQueue {
+	public:
+		typedef typename MyDeque<T, A>::size_type size_type;
+
+		// Called with each consumer to resume, instead of resuming it inline
+		typedef std::function<void (std::coroutine_handle<>)> scheduler_type;
+
+	private:
+		/**
+		 * A suspended consumer, with the item push_back handed to it
+		 */
+		struct Waiter {
+			std::coroutine_handle<> handle;
+			std::optional<T> item;
+		};
+
+		typedef typename std::allocator_traits<A>::template rebind_alloc<Waiter*> waiter_allocator_type;
+
+		MyDeque<T, A> myItems;
+		MyDeque<Waiter*, waiter_allocator_type> myWaiters;
+		scheduler_type mySchedule;
+
+	private:
+		/**
+		 * Give v to the longest waiting consumer and resume it
+		 * Returns false if no consumer is waiting
+		 */
+		template<typename U>
+		bool handOff(U&& v) {
+			if (myWaiters.empty())
+				return false;
+			Waiter* w = myWaiters.front();
+			myWaiters.pop_front();
+			w->item.emplace(std::forward<U>(v));
+			if (mySchedule)
+				mySchedule(w->handle);
+			else
+				w->handle.resume();
+			return true;
+		}
+
+	public:
+		/**
+		 * Awaiting it gives the oldest item, suspending until there is one
+		 */
+		class pop_awaiter {
+			private:
+				friend class AsyncQueue;
+
+				AsyncQueue& myQueue;
+				Waiter myWaiter;
+
+				explicit pop_awaiter(AsyncQueue& q) : myQueue(q), myWaiter() {}
+
+			public:
+				// Items only pile up while nobody waits, so any item can be taken now
+				bool await_ready() const {
+					return !myQueue.myItems.empty();
+				}
+
+				void await_suspend(std::coroutine_handle<> h) {
+					myWaiter.handle = h;
+					myQueue.myWaiters.push_back(&myWaiter);
+				}
+
+				T await_resume() {
+					if (myWaiter.item)
+						return std::move(*myWaiter.item);
+					T v = std::move(myQueue.myItems.front());
+					myQueue.myItems.pop_front();
+					return v;
+				}
+		};
+
+		/**
+		 * Awaiting it gives between 1 and k of the oldest items,
+		 * suspending until there is at least one
+		 * Whatever else is queued by the time the consumer runs joins the batch
+		 */
+		class pop_n_awaiter {
+			private:
+				friend class AsyncQueue;
+
+				AsyncQueue& myQueue;
+				size_type myLimit;
+				Waiter myWaiter;
+
+				pop_n_awaiter(AsyncQueue& q, size_type k) : myQueue(q), myLimit(k), myWaiter() {}
+
+			public:
+				bool await_ready() const {
+					return !myQueue.myItems.empty();
+				}
+
+				void await_suspend(std::coroutine_handle<> h) {
+					myWaiter.handle = h;
+					myQueue.myWaiters.push_back(&myWaiter);
+				}
+
+				std::vector<T> await_resume() {
+					std::vector<T> batch;
+					size_type n = std::min(myLimit, myQueue.myItems.size() + (myWaiter.item ? 1 : 0));
+					batch.reserve(n);
+					if (myWaiter.item) {
+						batch.push_back(std::move(*myWaiter.item));
+						--n;
+					}
+					myQueue.myItems.drain_front(n, std::back_inserter(batch));
+					return batch;
+				}
+		};
+
+	public:
+		/**
+		 * Create an empty queue that resumes consumers inline
+		 */
+		explicit AsyncQueue(const A& a = A()) :
+				myItems(a),
+				myWaiters(waiter_allocator_type(a)),
+				mySchedule() {}
+
+		/**
+		 * Create an empty queue that passes consumers to schedule to resume
+		 */
+		explicit AsyncQueue(scheduler_type schedule, const A& a = A()) :
+				myItems(a),
+				myWaiters(waiter_allocator_type(a)),
+				mySchedule(std::move(schedule)) {}
+
+		AsyncQueue(const AsyncQueue&) = delete;
+		AsyncQueue& operator =(const AsyncQueue&) = delete;
+
+		/**
+		 * co_await pop() gives the oldest item
+		 */
+		pop_awaiter pop() {
+			return pop_awaiter(*this);
+		}
+
+		/**
+		 * co_await pop_n(k) gives between 1 and k of the oldest items, oldest first
+		 */
+		pop_n_awaiter pop_n(size_type k) {
+			MYDEQUE_CHECK(k > 0);
+			return pop_n_awaiter(*this, k);
+		}
+
+		/**
+		 * Add an item, handing it to a waiting consumer if there is one
+		 */
+		void push_back(const T& v) {
+			if (!handOff(v))
+				myItems.push_back(v);
+		}
+
+		/**
+		 * Add an item, handing it to a waiting consumer if there is one
+		 */
+		void push_back(T&& v) {
+			if (!handOff(std::move(v)))
+				myItems.push_back(std::move(v));
+		}
+
+		/**
+		 * Returns true if no items are queued
+		 */
+		bool empty() const {
+			return myItems.empty();
+		}
+
+		/**
+		 * Returns the number of queued items
+		 */
+		size_type size() const {
+			return myItems.size();
+		}
+
+		/**
+		 * Returns the number of suspended consumers
+		 */
+		size_type waiting() const {
+			return myWaiters.size();
+		}
+};
+
+#endif // AsyncQueue_h
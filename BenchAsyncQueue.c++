@@ -0,0 +1,236 @@
+/*
+ * BenchAsyncQueue
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++20 -Wall BenchAsyncQueue.c++ -O2 -DNDEBUG -o BenchAsyncQueue -lpthread
+ *
+ * Then it can run with
+ * BenchAsyncQueue [items]
+ *
+ * items defaults to 10^7. The thread baselines go through the kernel on
+ * most handoffs, so they only run over the first 10^5 of them
+ */
+
+#include <algorithm>          // min
+#include <chrono>             // steady_clock
+#include <condition_variable> // condition_variable
+#include <coroutine>          // coroutine_handle
+#include <cstdio>             // printf
+#include <cstdlib>            // strtoul
+#include <deque>              // deque
+#include <mutex>              // mutex, unique_lock
+#include <thread>             // thread
+#include <vector>             // vector
+
+#include "AsyncQueue.h"
+#include "DequeTestSupport.h"
+
+void report(const char* name, double seconds, unsigned long items) {
+	std::printf("  %-40s %8.1f ns/item %10.1f M items/s\n", name,
+			seconds * 1e9 / items, items / seconds / 1e6);
+}
+
+// --- coroutine plumbing ---
+
+/**
+ * A single-threaded event loop: a first in, first out run queue of coroutines
+ */
+class RunQueue {
+	private:
+		MyDeque<std::coroutine_handle<> > ready;
+
+	public:
+		void schedule(std::coroutine_handle<> h) {
+			ready.push_back(h);
+		}
+
+		void run() {
+			while (!ready.empty()) {
+				std::coroutine_handle<> h = ready.front();
+				ready.pop_front();
+				h.resume();
+			}
+		}
+};
+
+Task consumeEach(AsyncQueue<long>& q, unsigned long n, long& total) {
+	for (unsigned long i = 0; i < n; ++i)
+		total += co_await q.pop();
+}
+
+Task consumeBatches(AsyncQueue<long>& q, unsigned long n, std::size_t k, long& total) {
+	for (unsigned long i = 0; i < n; ) {
+		std::vector<long> batch = co_await q.pop_n(k);
+		for (std::size_t j = 0; j < batch.size(); ++j)
+			total += batch[j];
+		i += batch.size();
+	}
+}
+
+Task echo(AsyncQueue<long>& in, AsyncQueue<long>& out, unsigned long n) {
+	for (unsigned long i = 0; i < n; ++i)
+		out.push_back(co_await in.pop() + 1);
+}
+
+Task serve(AsyncQueue<long>& in, AsyncQueue<long>& out, unsigned long n, long& total) {
+	for (unsigned long i = 0; i < n; ++i) {
+		out.push_back(i);
+		total += co_await in.pop();
+	}
+}
+
+// --- coroutine handoffs ---
+
+/**
+ * One consumer waiting on pop(), resumed inline by every push_back
+ */
+void benchInlineHandoff(unsigned long n) {
+	AsyncQueue<long> q;
+	long total = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	consumeEach(q, n, total);
+	for (unsigned long i = 0; i < n; ++i)
+		q.push_back(i);
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	sink() = total;
+	report("inline handoff, pop()", elapsed.count(), n);
+}
+
+/**
+ * Two coroutines bouncing an item between two queues through the run queue,
+ * so each item is one round trip
+ */
+void benchPingPong(unsigned long n) {
+	RunQueue loop;
+	AsyncQueue<long>::scheduler_type schedule = [&loop](std::coroutine_handle<> h) { loop.schedule(h); };
+	AsyncQueue<long> ping(schedule);
+	AsyncQueue<long> pong(schedule);
+	long total = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	echo(ping, pong, n);
+	serve(pong, ping, n, total);
+	loop.run();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	sink() = total;
+	report("scheduled ping-pong round trip", elapsed.count(), n);
+}
+
+/**
+ * A producer pushing bursts while the consumer waits in the run queue,
+ * taking the items one pop() at a time or k at a time with pop_n(k)
+ */
+void benchBursts(const char* name, unsigned long n, std::size_t burst, std::size_t k) {
+	RunQueue loop;
+	AsyncQueue<long> q([&loop](std::coroutine_handle<> h) { loop.schedule(h); });
+	long total = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	if (k == 1)
+		consumeEach(q, n, total);
+	else
+		consumeBatches(q, n, k, total);
+	for (unsigned long i = 0; i < n; ) {
+		for (std::size_t j = 0; j < burst && i < n; ++j, ++i)
+			q.push_back(i);
+		loop.run();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	sink() = total;
+	report(name, elapsed.count(), n);
+}
+
+// --- thread baselines ---
+
+/**
+ * What consumers do today: a thread blocked on a condition variable
+ */
+class BlockingQueue {
+	private:
+		std::mutex lock;
+		std::condition_variable nonEmpty;
+		std::deque<long> items;
+
+	public:
+		void push_back(long v) {
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				items.push_back(v);
+			}
+			nonEmpty.notify_one();
+		}
+
+		long pop() {
+			std::unique_lock<std::mutex> guard(lock);
+			nonEmpty.wait(guard, [this] { return !items.empty(); });
+			long v = items.front();
+			items.pop_front();
+			return v;
+		}
+};
+
+/**
+ * A producer thread feeding a consumer thread
+ */
+void benchThreadHandoff(unsigned long n) {
+	BlockingQueue q;
+	long total = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::thread consumer([&q, &total, n] {
+		for (unsigned long i = 0; i < n; ++i)
+			total += q.pop();
+	});
+	for (unsigned long i = 0; i < n; ++i)
+		q.push_back(i);
+	consumer.join();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	sink() = total;
+	report("condition_variable, 2 threads", elapsed.count(), n);
+}
+
+/**
+ * Two threads bouncing an item between two blocking queues
+ */
+void benchThreadPingPong(unsigned long n) {
+	BlockingQueue ping;
+	BlockingQueue pong;
+	long total = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::thread echoer([&ping, &pong, n] {
+		for (unsigned long i = 0; i < n; ++i)
+			pong.push_back(ping.pop() + 1);
+	});
+	for (unsigned long i = 0; i < n; ++i) {
+		ping.push_back(i);
+		total += pong.pop();
+	}
+	echoer.join();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	sink() = total;
+	report("condition_variable ping-pong round trip", elapsed.count(), n);
+}
+
+int main(int argc, char** argv) {
+	const unsigned long items = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 10000000UL;
+	const unsigned long threadItems = std::min(items, 100000UL);
+
+	std::printf("coroutine AsyncQueue, %lu items\n", items);
+	benchInlineHandoff(items);
+	benchPingPong(items);
+	benchBursts("bursts of 256, pop()", items, 256, 1);
+	benchBursts("bursts of 256, pop_n(64)", items, 256, 64);
+
+	std::printf("thread baselines, %lu items\n", threadItems);
+	benchThreadHandoff(threadItems);
+	benchThreadPingPong(threadItems);
+
+	return 0;
+}
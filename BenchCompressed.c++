@@ -0,0 +1,153 @@
+/*
+ * BenchCompressed
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++0x -Wall BenchCompressed.c++ -O2 -DNDEBUG -o BenchCompressed
+ *
+ * Then it can run with
+ * BenchCompressed [elements]
+ *
+ * elements defaults to 2^24. Each history is appended to a MyDeque<int64_t>
+ * and to a CompressedDeque<int64_t> that packs rows after 4096 ticks, then
+ * read back at random, front to back, and at the tail
+ */
+
+#include <chrono>  // steady_clock
+#include <cstdint> // int64_t
+#include <cstdio>  // printf
+#include <cstdlib> // strtoul
+
+#include "CompressedDeque.h"
+#include "Deque.h"
+#include "DequeTestSupport.h"
+
+void report(const char* name, double seconds, unsigned long operations) {
+	std::printf("    %-28s %8.2f ns/op\n", name, seconds * 1e9 / operations);
+}
+
+// --- histories ---
+
+/**
+ * Millisecond timestamps about a second apart
+ */
+struct Timestamps {
+	static const char* name() {
+		return "timestamps";
+	}
+
+	std::int64_t t;
+
+	Timestamps() : t(1600000000000LL) {}
+
+	std::int64_t operator ()(Samples& s) {
+		return t += 1000 + (s.bits() >> 11) % 50;
+	}
+};
+
+/**
+ * A gauge wandering between 0 and 4095
+ */
+struct Gauge {
+	static const char* name() {
+		return "gauge";
+	}
+
+	std::int64_t v;
+
+	Gauge() : v(2048) {}
+
+	std::int64_t operator ()(Samples& s) {
+		v += static_cast<std::int64_t>((s.bits() >> 11) % 33) - 16;
+		v = v < 0 ? 0 : v > 4095 ? 4095 : v;
+		return v;
+	}
+};
+
+/**
+ * Hashes, which nothing can pack
+ */
+struct Random {
+	static const char* name() {
+		return "random 53 bits";
+	}
+
+	std::int64_t operator ()(Samples& s) {
+		return static_cast<std::int64_t>(s.bits() >> 11);
+	}
+};
+
+// --- access ---
+
+template<typename C>
+void benchReads(const char* container, const C& x, unsigned long reads) {
+	std::printf("  %s\n", container);
+	const unsigned long n = x.size();
+	Samples s(17);
+	long total = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned long i = 0; i < reads; ++i)
+		total += x[(s.bits() >> 11) % n];
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	report("random read", elapsed.count(), reads);
+
+	start = std::chrono::steady_clock::now();
+	for (unsigned long i = 0; i < n; ++i)
+		total += x[i];
+	elapsed = std::chrono::steady_clock::now() - start;
+	report("front to back", elapsed.count(), n);
+
+	start = std::chrono::steady_clock::now();
+	for (unsigned long i = 0; i < reads; ++i)
+		total += x[n - 1 - (i & 127)];
+	elapsed = std::chrono::steady_clock::now() - start;
+	report("last 128", elapsed.count(), reads);
+
+	sink() = total;
+}
+
+template<typename History>
+void bench(unsigned long n, unsigned long reads) {
+	std::printf("%s, %lu elements\n", History::name(), n);
+	MyDeque<std::int64_t> plain;
+	CompressedDeque<std::int64_t> packed(4096);
+
+	History h;
+	Samples s(1);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned long i = 0; i < n; ++i)
+		plain.push_back(h(s));
+	std::chrono::duration<double> plainAppend = std::chrono::steady_clock::now() - start;
+
+	h = History();
+	s = Samples(1);
+	start = std::chrono::steady_clock::now();
+	for (unsigned long i = 0; i < n; ++i)
+		packed.push_back(h(s));
+	std::chrono::duration<double> packedAppend = std::chrono::steady_clock::now() - start;
+
+	double plainBytes = n * sizeof(std::int64_t);
+	std::printf("  resident %.1f MiB of %.1f MiB, %.2fx smaller, %lu of %lu rows packed\n",
+			packed.resident_bytes() / 1048576.0, plainBytes / 1048576.0,
+			plainBytes / packed.resident_bytes(),
+			(unsigned long) packed.compressed_rows(), (unsigned long) packed.rows());
+
+	std::printf("  MyDeque\n");
+	report("append", plainAppend.count(), n);
+	std::printf("  CompressedDeque\n");
+	report("append, packing as it goes", packedAppend.count(), n);
+
+	benchReads("MyDeque", plain, reads);
+	benchReads("CompressedDeque", packed, reads);
+}
+
+int main(int argc, char** argv) {
+	const unsigned long n = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1UL << 24;
+	const unsigned long reads = 10000000UL;
+
+	bench<Timestamps>(n, reads);
+	bench<Gauge>(n, reads);
+	bench<Random>(n, reads);
+
+	return 0;
+}
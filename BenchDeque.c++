@@ -0,0 +1,294 @@
+/*
+ * BenchDeque
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++0x -Wall BenchDeque.c++ -O2 -DNDEBUG -o BenchDeque
+ *
+ * Then it can run with
+ * BenchDeque
+ *
+ * make bench-checked builds the same program with MYDEQUE_HARDENING=1,
+ * to see what the cheap checks cost
+ *
+ * Cache misses are read from the hardware counters through perf_event_open,
+ * and are reported as n/a wherever those counters aren't available
+ */
+
+#include <chrono>    // steady_clock
+#include <cstdio>    // printf
+#include <cstring>   // memset
+#include <deque>     // deque
+#include <memory>    // allocator
+#include <tuple>     // make_tuple, tuple
+
+#include <linux/perf_event.h> // perf_event_attr
+#include <sys/ioctl.h>        // ioctl
+#include <sys/syscall.h>      // __NR_perf_event_open
+#include <unistd.h>           // close, read, syscall
+
+#include "Deque.h"
+#include "DequeTestSupport.h"
+#include "SoADeque.h"
+
+// --- instrumentation ---
+
+/**
+ * Counts every allocation made through it
+ */
+struct AllocationCount {
+	static unsigned long allocations;
+};
+
+unsigned long AllocationCount::allocations = 0;
+
+template<typename T>
+struct CountingAllocator : public std::allocator<T> {
+	template<typename U>
+	struct rebind {
+		typedef CountingAllocator<U> other;
+	};
+
+	CountingAllocator() {}
+
+	template<typename U>
+	CountingAllocator(const CountingAllocator<U>&) {}
+
+	T* allocate(std::size_t n) {
+		++AllocationCount::allocations;
+		return std::allocator<T>::allocate(n);
+	}
+};
+
+/**
+ * Counts the cache misses between start() and stop(),
+ * if the kernel lets us read the hardware counters
+ */
+class CacheMissCounter {
+	private:
+		int fd;
+
+	public:
+		CacheMissCounter() {
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		}
+
+		~CacheMissCounter() {
+			if (fd >= 0)
+				close(fd);
+		}
+
+		bool available() const {
+			return fd >= 0;
+		}
+
+		void start() {
+			if (fd < 0)
+				return;
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+
+		long long stop() {
+			if (fd < 0)
+				return -1;
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			long long count = 0;
+			if (read(fd, &count, sizeof(count)) != sizeof(count))
+				return -1;
+			return count;
+		}
+};
+
+void report(const char* name, double seconds, unsigned long operations,
+		unsigned long allocations, long long misses) {
+	std::printf("  %-28s %8.1f ns/op %8.2f allocs/op", name,
+			seconds * 1e9 / operations, double(allocations) / operations);
+	if (misses >= 0)
+		std::printf(" %8.2f misses/op\n", double(misses) / operations);
+	else
+		std::printf(" %14s\n", "n/a misses/op");
+}
+
+// --- short-lived deques ---
+
+/**
+ * Build and tear down many deques of at most a few dozen elements
+ */
+template<typename C>
+void benchShortLived(const char* name, unsigned long count) {
+	CacheMissCounter misses;
+	unsigned long allocations = AllocationCount::allocations;
+	misses.start();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	long total = 0;
+	for (unsigned long i = 0; i < count; ++i) {
+		C x;
+		const int n = i % 48;
+		for (int j = 0; j < n; ++j)
+			x.push_back(j);
+		total += x.size() ? x.back() : 0;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	long long missCount = misses.stop();
+	sink() = total;
+	report(name, elapsed.count(), count, AllocationCount::allocations - allocations, missCount);
+}
+
+// --- access paths ---
+
+/**
+ * Random-order operator[] over a deque of n ints
+ */
+template<typename C>
+void benchIndex(const char* name, unsigned long n, unsigned long rounds) {
+	C x;
+	for (unsigned long i = 0; i < n; ++i)
+		x.push_back(i);
+
+	CacheMissCounter misses;
+	misses.start();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	long total = 0;
+	unsigned long k = 0;
+	for (unsigned long r = 0; r < rounds; ++r)
+		for (unsigned long i = 0; i < n; ++i) {
+			// n is a power of two, so this visits every index once per round
+			k = (k + 7919) & (n - 1);
+			total += x[k];
+		}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	long long missCount = misses.stop();
+	sink() = total;
+	report(name, elapsed.count(), n * rounds, 0, missCount);
+}
+
+/**
+ * Walk a deque of n ints from begin() to end()
+ */
+template<typename C>
+void benchIterate(const char* name, unsigned long n, unsigned long rounds) {
+	C x;
+	for (unsigned long i = 0; i < n; ++i)
+		x.push_back(i);
+
+	CacheMissCounter misses;
+	misses.start();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	long total = 0;
+	for (unsigned long r = 0; r < rounds; ++r)
+		for (typename C::iterator i = x.begin(); i != x.end(); ++i)
+			total += *i;
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	long long missCount = misses.stop();
+	sink() = total;
+	report(name, elapsed.count(), n * rounds, 0, missCount);
+}
+
+// --- one field of a struct ---
+
+struct Trade {
+	long long timestamp;
+	double price;
+	int qty;
+};
+
+/**
+ * Sum the quantity of n trades kept whole in a MyDeque
+ */
+void benchFieldAoS(const char* name, unsigned long n, unsigned long rounds) {
+	MyDeque<Trade> x;
+	for (unsigned long i = 0; i < n; ++i) {
+		Trade t = {static_cast<long long>(i), i * 0.25, static_cast<int>(i % 100)};
+		x.push_back(t);
+	}
+
+	CacheMissCounter misses;
+	misses.start();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	long total = 0;
+	for (unsigned long r = 0; r < rounds; ++r)
+		for (MyDeque<Trade>::iterator i = x.begin(); i != x.end(); ++i)
+			total += i->qty;
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	long long missCount = misses.stop();
+	sink() = total;
+	report(name, elapsed.count(), n * rounds, 0, missCount);
+}
+
+/**
+ * Sum the quantity column of n trades kept in a SoADeque, one span at a time
+ * Each span is a plain int array, so the inner loop vectorizes
+ */
+void benchFieldSoA(const char* name, unsigned long n, unsigned long rounds) {
+	typedef SoADeque<std::tuple<long long, double, int> > Trades;
+	Trades x;
+	for (unsigned long i = 0; i < n; ++i)
+		x.push_back(std::make_tuple(static_cast<long long>(i), i * 0.25, static_cast<int>(i % 100)));
+
+	CacheMissCounter misses;
+	misses.start();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	long total = 0;
+	for (unsigned long r = 0; r < rounds; ++r)
+		for (SoASpan<int> s : x.column<2>())
+			for (const int* p = s.begin(); p != s.end(); ++p)
+				total += *p;
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	long long missCount = misses.stop();
+	sink() = total;
+	report(name, elapsed.count(), n * rounds, 0, missCount);
+}
+
+int main() {
+	const unsigned long shortLived = 2000000;
+	const unsigned long accessSize = 1 << 20;
+	const unsigned long accessRounds = 20;
+
+	std::printf("MYDEQUE_HARDENING %d\n", MYDEQUE_HARDENING);
+
+	std::printf("object sizes (bytes)\n");
+	std::printf("  %-28s %4lu, iterator %lu\n", "std::deque<int>",
+			(unsigned long) sizeof(std::deque<int>), (unsigned long) sizeof(std::deque<int>::iterator));
+	std::printf("  %-28s %4lu, iterator %lu\n", "MyDeque<int>",
+			(unsigned long) sizeof(MyDeque<int>), (unsigned long) sizeof(MyDeque<int>::iterator));
+	std::printf("  %-28s %4lu, iterator %lu\n", "MyDeque<int> small buffer",
+			(unsigned long) sizeof(MyDeque<int, std::allocator<int>, true>),
+			(unsigned long) sizeof(MyDeque<int, std::allocator<int>, true>::iterator));
+
+	std::printf("short-lived deques (%lu deques of 0-47 ints)\n", shortLived);
+	benchShortLived<std::deque<int, CountingAllocator<int> > >("std::deque", shortLived);
+	benchShortLived<MyDeque<int, CountingAllocator<int> > >("MyDeque", shortLived);
+	benchShortLived<MyDeque<int, CountingAllocator<int>, true> >("MyDeque small buffer", shortLived);
+
+	std::printf("operator[] in scattered order (%lu ints x %lu)\n", accessSize, accessRounds);
+	benchIndex<std::deque<int> >("std::deque", accessSize, accessRounds);
+	benchIndex<MyDeque<int> >("MyDeque", accessSize, accessRounds);
+
+	std::printf("iterate begin() to end() (%lu ints x %lu)\n", accessSize, accessRounds);
+	benchIterate<std::deque<int> >("std::deque", accessSize, accessRounds);
+	benchIterate<MyDeque<int> >("MyDeque", accessSize, accessRounds);
+
+	std::printf("sum one field of {timestamp, price, qty} (%lu trades x %lu)\n", accessSize, accessRounds);
+	benchFieldAoS("MyDeque<Trade>", accessSize, accessRounds);
+	benchFieldSoA("SoADeque column", accessSize, accessRounds);
+
+	return 0;
+}
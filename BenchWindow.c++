@@ -0,0 +1,119 @@
+/*
+ * BenchWindow
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++0x -Wall BenchWindow.c++ -O2 -DNDEBUG -o BenchWindow
+ *
+ * Then it can run with
+ * BenchWindow [samples]
+ *
+ * samples defaults to 10^8. The rescanning baseline is O(window) per sample,
+ * so it only runs over the first 10^6 of them
+ */
+
+#include <algorithm> // max, min
+#include <chrono>    // steady_clock
+#include <cstdio>    // printf
+#include <cstdlib>   // strtoul
+
+#include "DequeTestSupport.h"
+#include "SlidingWindow.h"
+
+/**
+ * Cheap deterministic samples, with timestamps that advance 0-3 ticks each
+ */
+class Stream {
+	private:
+		unsigned long state;
+		long long time;
+
+	public:
+		Stream() : state(1), time(0) {}
+
+		void next(long long& t, long& v) {
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			time += state & 3;
+			t = time;
+			v = static_cast<long>((state >> 8) % 100000);
+		}
+};
+
+void report(const char* name, double seconds, unsigned long samples) {
+	std::printf("  %-36s %8.2f ns/sample %10.1f M samples/s\n", name,
+			seconds * 1e9 / samples, samples / seconds / 1e6);
+}
+
+/**
+ * RollingStats over the stream, reading every aggregate after each sample
+ */
+void benchRollingStats(const char* name, unsigned long samples,
+		RollingStats<long>::size_type maxCount, long long maxAge) {
+	RollingStats<long> stats(maxCount, maxAge);
+	Stream stream;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	long total = 0;
+	for (unsigned long i = 0; i < samples; ++i) {
+		long long t;
+		long v;
+		stream.next(t, v);
+		stats.push(t, v);
+		total += stats.sum() + stats.min() + stats.max();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	sink() = total;
+	report(name, elapsed.count(), samples);
+}
+
+/**
+ * The workload we started from: keep the samples in a MyDeque,
+ * pop the expired ones and rescan the rest for each sample
+ */
+void benchRescan(const char* name, unsigned long samples, unsigned long maxCount) {
+	MyDeque<long> window;
+	Stream stream;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	long total = 0;
+	for (unsigned long i = 0; i < samples; ++i) {
+		long long t;
+		long v;
+		stream.next(t, v);
+		window.push_back(v);
+		if (window.size() > maxCount)
+			window.pop_front();
+
+		long sum = 0;
+		long lo = window.front();
+		long hi = window.front();
+		for (MyDeque<long>::iterator j = window.begin(); j != window.end(); ++j) {
+			sum += *j;
+			lo = std::min(lo, *j);
+			hi = std::max(hi, *j);
+		}
+		total += sum + lo + hi;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	sink() = total;
+	report(name, elapsed.count(), samples);
+}
+
+int main(int argc, char** argv) {
+	const unsigned long samples = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 100000000UL;
+	const unsigned long rescanSamples = std::min(samples, 1000000UL);
+	const RollingStats<long>::size_type unbounded = static_cast<RollingStats<long>::size_type>(-1);
+
+	std::printf("rolling sum/min/max, %lu samples\n", samples);
+	benchRollingStats("count window of 1024", samples, 1024, 1LL << 62);
+	benchRollingStats("count window of 1048576", samples, 1 << 20, 1LL << 62);
+	benchRollingStats("time window of 2048 ticks", samples, unbounded, 2048);
+
+	std::printf("rescanning MyDeque, %lu samples\n", rescanSamples);
+	benchRescan("count window of 1024", rescanSamples, 1024);
+
+	return 0;
+}
@@ -0,0 +1,471 @@
+// ---------------------------------
+// projects/deque/CompressedDeque.h
+// ---------------------------------
+
+#ifndef CompressedDeque_h
+#define CompressedDeque_h
+
+#include <cstddef>     // size_t
+#include <cstdint>     // uint64_t
+#include <memory>      // allocator, allocator_traits
+#include <stdexcept>   // out_of_range
+#include <type_traits> // is_integral
+
+#include "Deque.h"
+
+/**
+ * A deque of integers that packs the rows nobody is writing to any more
+ * Elements live in rows of ROW_SIZE, like MyDeque, and a MyDeque of rows
+ * is the directory
+ * Every write stamps its row with a logical clock that ticks once per
+ * push, pop and set, and each tick looks at one row between the hot ends,
+ * round robin. A row untouched for coldAfter ticks is packed by frame of
+ * reference: its minimum, then each element's distance from it in just
+ * enough bits for the largest distance. Rows that wouldn't get smaller
+ * stay as they are
+ * Reading a packed row unpacks the one element in place, and writing to
+ * it unpacks the whole row again. The hotRows rows at each end are never
+ * packed, so pushes and pops never unpack
+ * Elements come back by value, since a packed element has no address
+ */
+template<typename T, typename A = std::allocator<T> >
+class CompressedDeque {
+	public:
+		typedef T value_type;
+		typedef A allocator_type;
+
+		typedef std::size_t size_type;
+
+		static_assert(std::is_integral<T>::value && sizeof(T) <= sizeof(std::uint64_t),
+				"CompressedDeque holds integers of at most 64 bits");
+
+	private:
+		const static unsigned int LOG_ROW_SIZE = 7;
+		const static size_type ROW_SIZE = 1 << LOG_ROW_SIZE;
+
+		/**
+		 * One row of the directory
+		 * values is NULL once the row is packed
+		 */
+		struct Row {
+			T* values;
+			std::uint64_t* packed;
+			T base;
+			unsigned int bits;
+			unsigned long touched;
+		};
+
+		typedef typename std::allocator_traits<A>::template rebind_alloc<Row> directory_allocator_type;
+		typedef typename std::allocator_traits<A>::template rebind_alloc<std::uint64_t> packed_allocator_type;
+		typedef std::allocator_traits<A> allocator_traits;
+		typedef std::allocator_traits<packed_allocator_type> packed_allocator_traits;
+
+	private:
+		// Elements take up the slots from myStart to myStart + mySize,
+		// counting slots from the start of the first row
+		// Only the first row has slots before the front, and only the last
+		// row has slots after the back, so myStart is less than ROW_SIZE
+		MyDeque<Row, directory_allocator_type> myRows;
+		size_type myStart;
+		size_type mySize;
+
+		// A row kept back from the last row freed, so an end that keeps
+		// crossing a row boundary doesn't allocate each time
+		T* mySpare;
+
+		unsigned long myColdAfter;
+		size_type myHotRows;
+		unsigned long myClock;
+		size_type mySweep;
+
+		size_type myPackedRows;
+		size_type myPackedWords;
+
+		A myAllocator;
+		packed_allocator_type myPackedAllocator;
+
+	private:
+
+		bool valid() const {
+			if (myHotRows < 1)
+				return false;
+			if (mySize == 0)
+				return myRows.empty() && myStart == 0;
+			if (myStart >= ROW_SIZE)
+				return false;
+			// The last row must hold the back
+			if ((myStart + mySize + ROW_SIZE - 1) / ROW_SIZE != myRows.size())
+				return false;
+			if (!isHot(myRows.front()) || !isHot(myRows.back()))
+				return false;
+			return true;
+		}
+
+		static bool isHot(const Row& r) {
+			return r.values != NULL;
+		}
+
+		/**
+		 * Helper function for the number of words a row of width bits packs into
+		 */
+		static size_type packedWords(unsigned int bits) {
+			return (ROW_SIZE * bits + 63) / 64;
+		}
+
+		static std::uint64_t mask(unsigned int bits) {
+			return bits == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+		}
+
+		/**
+		 * Helper function to read the element at an offset in a packed row
+		 */
+		static T unpack(const Row& r, size_type offset) {
+			if (r.bits == 0)
+				return r.base;
+			size_type position = offset * r.bits;
+			size_type word = position >> 6;
+			unsigned int shift = position & 63;
+			std::uint64_t u = r.packed[word] >> shift;
+			if (shift + r.bits > 64)
+				u |= r.packed[word + 1] << (64 - shift);
+			return static_cast<T>(static_cast<std::uint64_t>(r.base) + (u & mask(r.bits)));
+		}
+
+		T* allocateRow() {
+			T* values = mySpare;
+			if (values == NULL)
+				values = allocator_traits::allocate(myAllocator, ROW_SIZE);
+			mySpare = NULL;
+			return values;
+		}
+
+		void deallocateRow(T* values) {
+			if (mySpare == NULL)
+				mySpare = values;
+			else
+				allocator_traits::deallocate(myAllocator, values, ROW_SIZE);
+		}
+
+		Row newRow() {
+			Row r = {allocateRow(), NULL, T(), 0, myClock};
+			return r;
+		}
+
+		/**
+		 * Free whatever storage r holds
+		 */
+		void release(Row& r) {
+			if (isHot(r))
+				deallocateRow(r.values);
+			else {
+				if (r.packed != NULL)
+					packed_allocator_traits::deallocate(myPackedAllocator, r.packed, packedWords(r.bits));
+				--myPackedRows;
+				myPackedWords -= packedWords(r.bits);
+			}
+		}
+
+		/**
+		 * Pack a full row, if that makes it smaller
+		 * Either way the row isn't looked at again for another coldAfter ticks
+		 */
+		void pack(Row& r) {
+			T lo = r.values[0];
+			T hi = r.values[0];
+			for (size_type i = 1; i < ROW_SIZE; ++i) {
+				if (r.values[i] < lo)
+					lo = r.values[i];
+				if (r.values[i] > hi)
+					hi = r.values[i];
+			}
+			std::uint64_t range = static_cast<std::uint64_t>(hi) - static_cast<std::uint64_t>(lo);
+			unsigned int bits = 0;
+			while (bits < 64 && (range >> bits) != 0)
+				++bits;
+
+			r.touched = myClock;
+			if (packedWords(bits) * sizeof(std::uint64_t) >= ROW_SIZE * sizeof(T))
+				return;
+
+			size_type words = packedWords(bits);
+			std::uint64_t* packed = words == 0 ? NULL : packed_allocator_traits::allocate(myPackedAllocator, words);
+			for (size_type i = 0; i < words; ++i)
+				packed[i] = 0;
+			for (size_type i = 0; bits > 0 && i < ROW_SIZE; ++i) {
+				std::uint64_t u = static_cast<std::uint64_t>(r.values[i]) - static_cast<std::uint64_t>(lo);
+				size_type position = i * bits;
+				unsigned int shift = position & 63;
+				packed[position >> 6] |= u << shift;
+				if (shift + bits > 64)
+					packed[(position >> 6) + 1] |= u >> (64 - shift);
+			}
+
+			deallocateRow(r.values);
+			r.values = NULL;
+			r.packed = packed;
+			r.base = lo;
+			r.bits = bits;
+			++myPackedRows;
+			myPackedWords += words;
+		}
+
+		/**
+		 * Unpack a row back into plain values
+		 */
+		void unpackRow(Row& r) {
+			if (isHot(r))
+				return;
+			T* values = allocateRow();
+			for (size_type i = 0; i < ROW_SIZE; ++i)
+				values[i] = unpack(r, i);
+			release(r);
+			r.values = values;
+			r.packed = NULL;
+			r.touched = myClock;
+		}
+
+		/**
+		 * Advance the clock, and pack the next row between the hot ends
+		 * if it has gone cold
+		 */
+		void tick() {
+			++myClock;
+			if (myColdAfter == 0 || myRows.size() <= 2 * myHotRows)
+				return;
+			if (mySweep < myHotRows || mySweep >= myRows.size() - myHotRows)
+				mySweep = myHotRows;
+			Row& r = myRows[mySweep++];
+			if (isHot(r) && myClock - r.touched >= myColdAfter)
+				pack(r);
+		}
+
+		/**
+		 * Free every row
+		 */
+		void releaseAll() {
+			while (!myRows.empty()) {
+				release(myRows.back());
+				myRows.pop_back();
+			}
+			myStart = 0;
+			mySweep = 0;
+		}
+
+	public:
+		/**
+		 * Create an empty CompressedDeque
+		 * Rows outside the hotRows at each end are packed once no write has
+		 * touched them for coldAfter ticks, and never if coldAfter is 0
+		 */
+		explicit CompressedDeque(unsigned long coldAfter = 0, size_type hotRows = 2, const allocator_type& a = allocator_type()) :
+				myRows(directory_allocator_type(a)),
+				myStart(0),
+				mySize(0),
+				mySpare(NULL),
+				myColdAfter(coldAfter),
+				myHotRows(hotRows),
+				myClock(0),
+				mySweep(0),
+				myPackedRows(0),
+				myPackedWords(0),
+				myAllocator(a),
+				myPackedAllocator(a) {
+			MYDEQUE_CHECK(hotRows >= 1);
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		CompressedDeque(const CompressedDeque&) = delete;
+		CompressedDeque& operator =(const CompressedDeque&) = delete;
+
+		/**
+		 * Release every row
+		 */
+		~CompressedDeque() {
+			releaseAll();
+			if (mySpare != NULL)
+				allocator_traits::deallocate(myAllocator, mySpare, ROW_SIZE);
+		}
+
+		/**
+		 * Returns the indexth element
+		 */
+		value_type operator [](size_type index) const {
+			MYDEQUE_CHECK(index < mySize);
+			size_type slot = myStart + index;
+			const Row& r = myRows[slot >> LOG_ROW_SIZE];
+			if (isHot(r))
+				return r.values[slot & (ROW_SIZE - 1)];
+			return unpack(r, slot & (ROW_SIZE - 1));
+		}
+
+		/**
+		 * Returns the indexth element
+		 */
+		value_type at(size_type index) const {
+			if (index >= mySize)
+				throw std::out_of_range("index out of range");
+			return (*this)[index];
+		}
+
+		/**
+		 * Returns the last element
+		 */
+		value_type back() const {
+			MYDEQUE_CHECK(!empty());
+			return (*this)[mySize - 1];
+		}
+
+		/**
+		 * Remove every element
+		 */
+		void clear() {
+			mySize = 0;
+			releaseAll();
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Pack every row between the hot ends that would get smaller,
+		 * however recently it was written
+		 */
+		void compress() {
+			for (size_type i = myHotRows; i + myHotRows < myRows.size(); ++i)
+				if (isHot(myRows[i]))
+					pack(myRows[i]);
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Returns the number of rows packed right now
+		 */
+		size_type compressed_rows() const {
+			return myPackedRows;
+		}
+
+		/**
+		 * Return true if this CompressedDeque is empty
+		 */
+		bool empty() const {
+			return !size();
+		}
+
+		/**
+		 * Returns the first element
+		 */
+		value_type front() const {
+			MYDEQUE_CHECK(!empty());
+			return (*this)[0];
+		}
+
+		/**
+		 * Remove the last element
+		 */
+		void pop_back() {
+			MYDEQUE_CHECK(!empty());
+			--mySize;
+			if (mySize == 0)
+				releaseAll();
+			else if (myStart + mySize == (myRows.size() - 1) * ROW_SIZE) {
+				release(myRows.back());
+				myRows.pop_back();
+				if (myRows.size() >= myHotRows)
+					unpackRow(myRows[myRows.size() - myHotRows]);
+			}
+			tick();
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Remove the first element
+		 */
+		void pop_front() {
+			MYDEQUE_CHECK(!empty());
+			++myStart;
+			--mySize;
+			if (mySize == 0)
+				releaseAll();
+			else if (myStart == ROW_SIZE) {
+				release(myRows.front());
+				myRows.pop_front();
+				myStart = 0;
+				if (mySweep > 0)
+					--mySweep;
+				if (myRows.size() >= myHotRows)
+					unpackRow(myRows[myHotRows - 1]);
+			}
+			tick();
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Add an element to the back
+		 */
+		void push_back(const value_type& v) {
+			size_type slot = myStart + mySize;
+			if (slot == myRows.size() * ROW_SIZE)
+				myRows.push_back(newRow());
+			Row& r = myRows[slot >> LOG_ROW_SIZE];
+			r.values[slot & (ROW_SIZE - 1)] = v;
+			r.touched = myClock;
+			++mySize;
+			tick();
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Add an element to the front
+		 */
+		void push_front(const value_type& v) {
+			if (myStart == 0) {
+				myRows.push_front(newRow());
+				myStart = ROW_SIZE;
+				++mySweep;
+			}
+			--myStart;
+			Row& r = myRows.front();
+			r.values[myStart] = v;
+			r.touched = myClock;
+			++mySize;
+			tick();
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Returns the bytes the rows take up, packed or not,
+		 * not counting the directory
+		 */
+		size_type resident_bytes() const {
+			return (myRows.size() - myPackedRows) * ROW_SIZE * sizeof(T) +
+					myPackedWords * sizeof(std::uint64_t);
+		}
+
+		/**
+		 * Returns the number of rows
+		 */
+		size_type rows() const {
+			return myRows.size();
+		}
+
+		/**
+		 * Overwrite the indexth element, unpacking its row if it's packed
+		 */
+		void set(size_type index, const value_type& v) {
+			MYDEQUE_CHECK(index < mySize);
+			size_type slot = myStart + index;
+			Row& r = myRows[slot >> LOG_ROW_SIZE];
+			unpackRow(r);
+			r.values[slot & (ROW_SIZE - 1)] = v;
+			r.touched = myClock;
+			tick();
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Return the number of elements in this CompressedDeque
+		 */
+		size_type size() const {
+			return mySize;
+		}
+};
+
+#endif // CompressedDeque_h
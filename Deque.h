@@ -9,23 +9,61 @@
 
 #include <iostream>
 
-#include <algorithm> // copy, equal, lexicographical_compare, max, swap
-#include <cassert>   // assert
-#include <iterator>  // iterator, bidirectional_iterator_tag
-#include <memory>    // allocator
-#include <stdexcept> // out_of_range
-#include <utility>   // !=, <=, >, >=
+#include <algorithm>   // copy, equal, fill, lexicographical_compare, max, min, move, move_backward, rotate, swap
+#include <cstddef>     // size_t
+#include <cstdlib>     // abort
+#include <cstring>     // memcpy
+#include <iterator>    // advance, distance, iterator_traits, random_access_iterator_tag
+#include <memory>      // allocator, allocator_traits
+#include <stdexcept>   // out_of_range
+#include <type_traits> // aligned_storage, enable_if, integral_constant, is_integral, is_same, is_trivially_copyable, is_trivially_destructible, remove_cv
+#include <utility>     // !=, <=, >, >=, move
 
 using std::rel_ops::operator!=;
 using std::rel_ops::operator<=;
 using std::rel_ops::operator>;
 using std::rel_ops::operator>=;
 
+// MYDEQUE_HARDENING picks how much checking MyDeque does
+//   0 - none
+//   1 - cheap O(1) checks, like indexing past the end or popping an empty deque
+//   2 - the cheap checks, plus the full invariant on every operation
+// It defaults to 0 when NDEBUG is defined, 2 otherwise
+// Unlike assert, level 1 keeps checking in NDEBUG builds
+#ifndef MYDEQUE_HARDENING
+	#ifdef NDEBUG
+		#define MYDEQUE_HARDENING 0
+	#else
+		#define MYDEQUE_HARDENING 2
+	#endif
+#endif
+
+/**
+ * Reports a failed MyDeque check and aborts
+ */
+inline void my_deque_check_failed(const char* condition, const char* file, int line) {
+	std::cerr << file << ":" << line << ": MyDeque check failed: " << condition << std::endl;
+	std::abort();
+}
+
+#if MYDEQUE_HARDENING >= 1
+	#define MYDEQUE_CHECK(condition) \
+		((condition) ? (void) 0 : my_deque_check_failed(#condition, __FILE__, __LINE__))
+#else
+	#define MYDEQUE_CHECK(condition) ((void) 0)
+#endif
+
+#if MYDEQUE_HARDENING >= 2
+	#define MYDEQUE_INVARIANT(condition) MYDEQUE_CHECK(condition)
+#else
+	#define MYDEQUE_INVARIANT(condition) ((void) 0)
+#endif
+
 template<typename A, typename BI>
 BI destroy(A& a, BI b, BI e) {
 	while (b != e) {
 		--e;
-		a.destroy(&*e);
+		std::allocator_traits<A>::destroy(a, &*e);
 	}
 	return b;
 }
@@ -35,7 +73,7 @@ BI uninitialized_copy(A& a, II b, II e, BI x) {
 	BI p = x;
 	try {
 		while (b != e) {
-			a.construct(&*x, *b);
+			std::allocator_traits<A>::construct(a, &*x, *b);
 			++b;
 			++x;
 		}
@@ -52,7 +90,7 @@ BI uninitialized_fill(A& a, BI b, BI e, const U& v) {
 	BI p = b;
 	try {
 		while (b != e) {
-			a.construct(&*b, v);
+			std::allocator_traits<A>::construct(a, &*b, v);
 			++b;
 		}
 	}
@@ -63,38 +101,390 @@ BI uninitialized_fill(A& a, BI b, BI e, const U& v) {
 	return e;
 }
 
-template<typename T, typename A = std::allocator<T> >
-class MyDeque {
+/**
+ * Constructs copies of [b, e) in the uninitialized row segment at x
+ */
+template<typename A, typename II, typename T>
+T* uninitialized_copy_segment(A& a, II b, II e, T* x) {
+	return uninitialized_copy(a, b, e, x);
+}
+
+template<typename A, typename U, typename T>
+T* uninitialized_copy_segment(A&, U* b, U* e, T* x, std::true_type) {
+	std::memcpy(static_cast<void*>(x), b, (e - b) * sizeof(T));
+	return x + (e - b);
+}
+
+template<typename A, typename U, typename T>
+T* uninitialized_copy_segment(A& a, U* b, U* e, T* x, std::false_type) {
+	return uninitialized_copy(a, b, e, x);
+}
+
+/**
+ * Constructs copies of the contiguous [b, e) in the uninitialized row
+ * segment at x, using memcpy when T is trivially copyable
+ * The choice is made at compile time, so memcpy is never instantiated
+ * for any other T
+ */
+template<typename A, typename U, typename T>
+T* uninitialized_copy_segment(A& a, U* b, U* e, T* x) {
+	return uninitialized_copy_segment(a, b, e, x, std::integral_constant<bool,
+			std::is_same<typename std::remove_cv<U>::type, T>::value &&
+			std::is_trivially_copyable<T>::value>());
+}
+
+/**
+ * Moves [b, e) into x, returning the end of the output
+ */
+template<typename T, typename OI>
+OI move_segment(T* b, T* e, OI x) {
+	return std::move(b, e, x);
+}
+
+template<typename T>
+T* move_segment(T* b, T* e, T* x, std::true_type) {
+	std::memcpy(static_cast<void*>(x), b, (e - b) * sizeof(T));
+	return x + (e - b);
+}
+
+template<typename T>
+T* move_segment(T* b, T* e, T* x, std::false_type) {
+	return std::move(b, e, x);
+}
+
+/**
+ * Moves [b, e) into the contiguous buffer at x,
+ * using memcpy when T is trivially copyable
+ * As with uninitialized_copy_segment, the choice is made at compile time
+ */
+template<typename T>
+T* move_segment(T* b, T* e, T* x) {
+	return move_segment(b, e, x, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+}
+
+/**
+ * The row and one-row map a MyDeque keeps inside the object itself when
+ * its small buffer is enabled, so short deques never touch the heap
+ * Rows must all be the same size, so the small row is a full row
+ */
+template<typename T, typename P, std::size_t N, bool SmallBuffer>
+struct MyDequeSmallBuffer {
+	typename std::aligned_storage<N * sizeof(T), alignof(T)>::type row;
+	P map[1];
+	bool rowInUse;
+
+	MyDequeSmallBuffer() : rowInUse(false) {}
+
+	/**
+	 * Hands out the small row, or NULL if it is already in use
+	 */
+	P takeRow() {
+		if (rowInUse)
+			return NULL;
+		rowInUse = true;
+		return reinterpret_cast<P>(&row);
+	}
+
+	/**
+	 * Returns true if r is the small row
+	 */
+	bool ownsRow(P r) const {
+		return r == reinterpret_cast<const T*>(&row);
+	}
+
+	/**
+	 * Marks the small row as free again
+	 */
+	void giveRow() {
+		rowInUse = false;
+	}
+
+	/**
+	 * Hands out the small map if it can hold n rows and current
+	 * isn't already using it, otherwise NULL
+	 */
+	P* takeMap(std::size_t n, P* current) {
+		if (n > 1 || current == map)
+			return NULL;
+		return map;
+	}
+
+	/**
+	 * Returns true if m is the small map
+	 */
+	bool ownsMap(P* m) const {
+		return m == map;
+	}
+};
+
+/**
+ * Without the small buffer every row and map comes from the allocator
+ */
+template<typename T, typename P, std::size_t N>
+struct MyDequeSmallBuffer<T, P, N, false> {
+	P takeRow() {
+		return NULL;
+	}
+
+	bool ownsRow(P) const {
+		return false;
+	}
+
+	void giveRow() {}
+
+	P* takeMap(std::size_t, P*) {
+		return NULL;
+	}
+
+	bool ownsMap(P*) const {
+		return false;
+	}
+};
+
+/**
+ * The map bookkeeping MyDeque and SoADeque share, as a base class D derives
+ * from and befriends, so either container keeps its own row type
+ * D holds the map, myMap, myMapSize, myStart and mySize, and hands out rows
+ * and maps through allocateRow, deallocateRow, allocateMap and deallocateMap
+ * Slots may be empty: rows are allocated only as the elements reach them,
+ * and the ones elements leave stay in their slots as spares
+ */
+template<typename D, typename S>
+class MyDequeMap {
+	protected:
+		/**
+		 * Returns true if the map holds the rows the elements need
+		 */
+		bool validMap() const {
+			const D& d = static_cast<const D&>(*this);
+			if (d.myMap == NULL)
+				return false;
+			if (d.myMapSize < 1)
+				return false;
+			// The slot end() points at must always be allocated
+			if (d.myStart + d.mySize >= d.myMapSize * D::ROW_SIZE)
+				return false;
+			// Rows are allocated from the first element's to end()'s,
+			// slots outside of those may be empty or hold spare rows
+			if (d.myMap[d.myStart >> D::LOG_ROW_SIZE] == NULL || d.myMap[(d.myStart + d.mySize) >> D::LOG_ROW_SIZE] == NULL)
+				return false;
+			return true;
+		}
+
+		/**
+		 * Helper function to initialize the memory
+		 */
+		void initMap() {
+			D& d = static_cast<D&>(*this);
+			d.myMap = d.allocateMap(1);
+			*d.myMap = d.allocateRow();
+			d.myMapSize = 1;
+			d.myStart = D::ROW_SIZE / 2;
+		}
+
+		/**
+		 * Helper function to deallocate every row and the map
+		 */
+		void destroyMap() {
+			D& d = static_cast<D&>(*this);
+			for (S i = 0; i < d.myMapSize; ++i)
+				d.deallocateRow(d.myMap[i]);
+			d.deallocateMap(d.myMap, d.myMapSize);
+		}
+
+		/**
+		 * Helper function to replace the map with one n slots longer,
+		 * the new slots empty and at its front or its back
+		 */
+		void growMap(S n, bool front) {
+			D& d = static_cast<D&>(*this);
+			typename D::map_pointer newMap = d.allocateMap(d.myMapSize + n);
+			uninitialized_copy(d.myMapAllocator, d.myMap, d.myMap + d.myMapSize, newMap + (front ? n : 0));
+			for (S i = 0; i < n; ++i)
+				newMap[front ? i : d.myMapSize + i] = NULL;
+
+			d.deallocateMap(d.myMap, d.myMapSize);
+			d.myMap = newMap;
+			d.myMapSize += n;
+
+			// Every element moved n rows further from the start of the map
+			if (front)
+				d.myStart += n * D::ROW_SIZE;
+		}
+
+		/**
+		 * Add at least n slots to the front of the map
+		 * Only the slots: rows are allocated as the elements reach them
+		 */
+		void addSlotsFront(S n) {
+			D& d = static_cast<D&>(*this);
+			// Grow by an eighth of the map at a time, so pushing one row after another
+			// doesn't copy the whole map for each of them
+			n = std::max(n, d.myMapSize / 8);
+
+			// Reuse the slots behind the end before growing, along with any spare
+			// rows in them, so a deque used as a queue stops growing
+			// All of them move in one rotation, which the slots it frees pay for
+			S spareBack = d.myMapSize - 1 - ((d.myStart + d.mySize) >> D::LOG_ROW_SIZE);
+			if (spareBack >= n) {
+				std::rotate(d.myMap, d.myMap + d.myMapSize - spareBack, d.myMap + d.myMapSize);
+				d.myStart += spareBack * D::ROW_SIZE;
+			}
+			else
+				growMap(n, true);
+		}
+
+		/**
+		 * Add at least n slots to the back of the map
+		 * Only the slots: rows are allocated as the elements reach them
+		 */
+		void addSlotsBack(S n) {
+			D& d = static_cast<D&>(*this);
+			n = std::max(n, d.myMapSize / 8);
+
+			// Reuse the slots in front of the beginning before growing
+			S spareFront = d.myStart >> D::LOG_ROW_SIZE;
+			if (spareFront >= n) {
+				std::rotate(d.myMap, d.myMap + spareFront, d.myMap + d.myMapSize);
+				d.myStart -= spareFront * D::ROW_SIZE;
+			}
+			else
+				growMap(n, false);
+		}
+
+		/**
+		 * Make sure n more elements fit in front of the first element,
+		 * adding all of the missing slots in one step and allocating
+		 * only the rows those elements land in that aren't spares
+		 */
+		void reserveFront(S n) {
+			D& d = static_cast<D&>(*this);
+			if (n > d.myStart)
+				addSlotsFront((n - d.myStart + D::ROW_SIZE - 1) / D::ROW_SIZE);
+			for (S r = (d.myStart - n) >> D::LOG_ROW_SIZE; r < (d.myStart >> D::LOG_ROW_SIZE); ++r)
+				if (d.myMap[r] == NULL)
+					d.myMap[r] = d.allocateRow();
+			MYDEQUE_INVARIANT(d.valid());
+		}
+
+		/**
+		 * Make sure n more elements fit behind the last element,
+		 * adding all of the missing slots in one step and allocating
+		 * only the rows those elements land in that aren't spares
+		 * The slot end() points at always stays allocated
+		 */
+		void reserveBack(S n) {
+			D& d = static_cast<D&>(*this);
+			if (((d.myStart + d.mySize + n) >> D::LOG_ROW_SIZE) >= d.myMapSize)
+				addSlotsBack(((d.myStart + d.mySize + n) >> D::LOG_ROW_SIZE) - d.myMapSize + 1);
+			S last = (d.myStart + d.mySize + n) >> D::LOG_ROW_SIZE;
+			for (S r = ((d.myStart + d.mySize) >> D::LOG_ROW_SIZE) + 1; r <= last; ++r)
+				if (d.myMap[r] == NULL)
+					d.myMap[r] = d.allocateRow();
+			MYDEQUE_INVARIANT(d.valid());
+		}
+
+		/**
+		 * Deallocate every row outside of rows [first, last)
+		 * and shrink the map to fit the remaining rows
+		 */
+		void releaseRows(S first, S last) {
+			D& d = static_cast<D&>(*this);
+			S newMapSize = last - first;
+			if (newMapSize == d.myMapSize)
+				return;
+
+			// The rows themselves don't move, so only the map changes
+			// It's allocated first, so nothing is freed if that throws
+			typename D::map_pointer newMap = d.allocateMap(newMapSize);
+			uninitialized_copy(d.myMapAllocator, d.myMap + first, d.myMap + last, newMap);
+
+			for (S i = 0; i < first; ++i)
+				d.deallocateRow(d.myMap[i]);
+			for (S i = last; i < d.myMapSize; ++i)
+				d.deallocateRow(d.myMap[i]);
+			d.deallocateMap(d.myMap, d.myMapSize);
+			d.myMap = newMap;
+			d.myMapSize = newMapSize;
+			d.myStart -= first * D::ROW_SIZE;
+
+			MYDEQUE_INVARIANT(d.valid());
+		}
+
+		/**
+		 * Deallocate every row but the first element's, once the elements are gone,
+		 * and move that row to the middle of the map, with room to grow toward either end
+		 * Like std::deque, the map keeps its size, so this never allocates
+		 */
+		void clearRows() {
+			D& d = static_cast<D&>(*this);
+			S keep = d.myStart >> D::LOG_ROW_SIZE;
+			typename D::row_pointer row = d.myMap[keep];
+			for (S i = 0; i < d.myMapSize; ++i) {
+				if (i != keep)
+					d.deallocateRow(d.myMap[i]);
+				d.myMap[i] = NULL;
+			}
+			d.myMap[d.myMapSize / 2] = row;
+			d.myStart = (d.myMapSize / 2) * D::ROW_SIZE + D::ROW_SIZE / 2;
+			d.mySize = 0;
+			MYDEQUE_INVARIANT(d.valid());
+		}
+};
+
+/**
+ * SmallBuffer keeps the first row and a one-row map inside the MyDeque,
+ * spilling to the allocator only once the deque outgrows that row
+ */
+template<typename T, typename A = std::allocator<T>, bool SmallBuffer = false>
+class MyDeque : private MyDequeMap<MyDeque<T, A, SmallBuffer>, typename std::allocator_traits<A>::size_type> {
 	public:
 		typedef A allocator_type;
-		typedef typename allocator_type::value_type value_type;
+		typedef std::allocator_traits<allocator_type> allocator_traits;
+		typedef typename allocator_traits::value_type value_type;
 
-		typedef typename allocator_type::size_type size_type;
-		typedef typename allocator_type::difference_type difference_type;
+		typedef typename allocator_traits::size_type size_type;
+		typedef typename allocator_traits::difference_type difference_type;
 
-		typedef typename allocator_type::pointer pointer;
-		typedef typename allocator_type::const_pointer const_pointer;
+		typedef typename allocator_traits::pointer pointer;
+		typedef typename allocator_traits::const_pointer const_pointer;
 
-		typedef typename allocator_type::reference reference;
-		typedef typename allocator_type::const_reference const_reference;
+		typedef value_type& reference;
+		typedef const value_type& const_reference;
 
-		typedef typename allocator_type::template rebind<pointer>::other map_allocator_type;
-        typedef typename map_allocator_type::pointer map_pointer;
+		// The map comes from a copy of the user's allocator, rebound to row pointers
+		typedef typename allocator_traits::template rebind_alloc<pointer> map_allocator_type;
+		typedef std::allocator_traits<map_allocator_type> map_allocator_traits;
+        typedef typename map_allocator_traits::pointer map_pointer;
 
 	private:
 		const static unsigned int LOG_ROW_SIZE = 7;
 		const static difference_type ROW_SIZE = 1 << LOG_ROW_SIZE;
 
+		// Rows and the map are managed by MyDequeMap, shared with SoADeque
+		typedef MyDequeMap<MyDeque, size_type> map_base;
+		friend class MyDequeMap<MyDeque, size_type>;
+		typedef pointer row_pointer;
+
+		using map_base::initMap;
+		using map_base::destroyMap;
+		using map_base::reserveFront;
+		using map_base::reserveBack;
+		using map_base::clearRows;
+		using map_base::releaseRows;
+
 	public:
-        // These are constant time +=, so I could use it later
+        // These are constant time +=, so they're random access iterators
 		class iterator {
 			public:
-                typedef std::bidirectional_iterator_tag   iterator_category;
+                typedef std::random_access_iterator_tag   iterator_category;
                 typedef typename MyDeque::value_type      value_type;
                 typedef typename MyDeque::difference_type difference_type;
                 typedef typename MyDeque::pointer         pointer;
                 typedef typename MyDeque::reference       reference;
 
+				friend class MyDeque;
+
 				/**
 				 * Compares the iterators for equality
 				 */
@@ -119,9 +509,30 @@ class MyDeque {
                     // if they're equal, compare items
                     return (lhs.currentRow == rhs.currentRow) ?
                             (lhs.currentItem < rhs.currentItem):
-                            (lhs.currentRow < lhs.currentRow);
+                            (lhs.currentRow < rhs.currentRow);
                 }
 
+				/**
+				 * Returns true if lhs is after rhs
+				 */
+				friend bool operator >(const iterator& lhs, const iterator& rhs) {
+					return rhs < lhs;
+				}
+
+				/**
+				 * Returns true if lhs is before rhs or the same
+				 */
+				friend bool operator <=(const iterator& lhs, const iterator& rhs) {
+					return !(rhs < lhs);
+				}
+
+				/**
+				 * Returns true if lhs is after rhs or the same
+				 */
+				friend bool operator >=(const iterator& lhs, const iterator& rhs) {
+					return !(lhs < rhs);
+				}
+
 				/**
 				 * Move the iterator rhs steps forward
 				 */
@@ -129,6 +540,13 @@ class MyDeque {
 					return lhs += rhs;
 				}
 
+				/**
+				 * Move the iterator rhs forward lhs steps
+				 */
+				friend iterator operator +(difference_type lhs, iterator rhs) {
+					return rhs += lhs;
+				}
+
 				/**
 				 * Move the iterator rhs steps back
 				 */
@@ -136,45 +554,46 @@ class MyDeque {
 					return lhs -= rhs;
 				}
 
+				/**
+				 * Returns the number of steps from rhs to lhs, in constant time
+				 */
+				friend difference_type operator -(const iterator& lhs, const iterator& rhs) {
+					return (lhs.currentRow - rhs.currentRow) * ROW_SIZE +
+							(lhs.currentItem - *lhs.currentRow) - (rhs.currentItem - *rhs.currentRow);
+				}
+
 			private:
-                pointer currentItem;
+                // Just the row and the item, so an iterator fits in two registers
+                // The row's bounds are one load away through currentRow
                 map_pointer currentRow;
-                pointer rowBegin;
-                pointer rowEnd;
+                pointer currentItem;
 
 			private:
 
                 bool valid() const {
-                	
                     if (currentRow == NULL)
                         return false;
-                    if (currentItem < rowBegin)
+                    if (currentItem < *currentRow)
                         return false;
-                    if (currentItem >= rowEnd)
+                    if (currentItem >= *currentRow + ROW_SIZE)
                         return false;
                     return true;
                 }
 
-                void setRow(map_pointer newRow) {
-                    currentRow = newRow;
-                    rowBegin = *newRow;
-                    rowEnd = rowBegin + ROW_SIZE;
-                }
-
 			public:
                 /**
                  * Creates an empty iterator
                  * Does NOT create a valid iterator
                  */
-                iterator() : currentItem(NULL), currentRow(NULL), rowBegin(NULL), rowEnd(NULL) {
-                    assert(!valid());
+                iterator() : currentRow(NULL), currentItem(NULL) {
+                    MYDEQUE_INVARIANT(!valid());
                 }
 
 				/**
 				 * Creates a new iterator using a pointer to the object and the row
 				 */
-				iterator(pointer item, map_pointer row) : currentItem(item), currentRow(row), rowBegin(*row), rowEnd(rowBegin + ROW_SIZE) {
-                    assert(valid());
+				iterator(pointer item, map_pointer row) : currentRow(row), currentItem(item) {
+                    MYDEQUE_INVARIANT(valid());
                 }
 
 				/**
@@ -191,12 +610,21 @@ class MyDeque {
 					return &**this;
 				}
 
+				/**
+				 * Return the object d steps from the one this iterator points to
+				 */
+				reference operator [](difference_type d) const {
+					return *(*this + d);
+				}
+
 				/**
 				 * Move this iterator forward by 1
 				 */
 				iterator& operator ++() {
-					*this += 1;
-					assert(valid());
+					MYDEQUE_INVARIANT(valid());
+					if (++currentItem == *currentRow + ROW_SIZE)
+						currentItem = *++currentRow;
+					MYDEQUE_INVARIANT(valid());
 					return *this;
 				}
 
@@ -207,7 +635,7 @@ class MyDeque {
 				iterator operator ++(int) {
 					iterator x = *this;
 					++(*this);
-					assert(valid());
+					MYDEQUE_INVARIANT(valid());
 					return x;
 				}
 
@@ -215,8 +643,11 @@ class MyDeque {
 				 * Move this iterator back by 1
 				 */
 				iterator& operator --() {
-					*this -= 1;
-					assert(valid());
+					MYDEQUE_INVARIANT(valid());
+					if (currentItem == *currentRow)
+						currentItem = *--currentRow + ROW_SIZE;
+					--currentItem;
+					MYDEQUE_INVARIANT(valid());
 					return *this;
 				}
 
@@ -227,7 +658,7 @@ class MyDeque {
 				iterator operator --(int) {
 					iterator x = *this;
 					--(*this);
-					assert(valid());
+					MYDEQUE_INVARIANT(valid());
 					return x;
 				}
 
@@ -235,25 +666,24 @@ class MyDeque {
 				 * Move the iterator forward by d steps
 				 */
 				iterator& operator +=(difference_type d) {
-					assert(valid());
+					MYDEQUE_INVARIANT(valid());
 
-                    difference_type newPosition = d + (currentItem - rowBegin);
+                    difference_type newPosition = d + (currentItem - *currentRow);
 
                     // Same row
                     if (newPosition >= 0 && newPosition < ROW_SIZE)
                         currentItem += d;
                     else {
                         // Set the offset to the new row
-                        // If 
                         difference_type newRow = newPosition > 0 ?
                             newPosition / ROW_SIZE :
                             -((-newPosition - 1) / ROW_SIZE) - 1;
 
                        	difference_type offset = newPosition - newRow * ROW_SIZE;
-                        setRow(currentRow + newRow);
-                        currentItem = rowBegin + offset;
+                        currentRow += newRow;
+                        currentItem = *currentRow + offset;
                     }
-					assert(valid());
+					MYDEQUE_INVARIANT(valid());
 					return *this;
 				}
 
@@ -262,7 +692,7 @@ class MyDeque {
 				 */
 				iterator& operator -=(difference_type d) {
 					*this += -d;
-					assert(valid());
+					MYDEQUE_INVARIANT(valid());
 					return *this;
 				}
 		};
@@ -270,12 +700,14 @@ class MyDeque {
 	public:
 		class const_iterator {
 			public:
-				typedef std::bidirectional_iterator_tag iterator_category;
+				typedef std::random_access_iterator_tag iterator_category;
 				typedef typename MyDeque::value_type value_type;
 				typedef typename MyDeque::difference_type difference_type;
 				typedef typename MyDeque::const_pointer pointer;
 				typedef typename MyDeque::const_reference reference;
 
+				friend class MyDeque;
+
 			public:
 				/**
 				 * Compare the iterators for equality
@@ -299,9 +731,30 @@ class MyDeque {
                     // if they're equal, compare items
                     return (lhs.currentRow == rhs.currentRow) ?
                             (lhs.currentItem < rhs.currentItem):
-                            (lhs.currentRow < lhs.currentRow);
+                            (lhs.currentRow < rhs.currentRow);
                 }
 
+				/**
+				 * Returns true if lhs is after rhs
+				 */
+				friend bool operator >(const const_iterator& lhs, const const_iterator& rhs) {
+					return rhs < lhs;
+				}
+
+				/**
+				 * Returns true if lhs is before rhs or the same
+				 */
+				friend bool operator <=(const const_iterator& lhs, const const_iterator& rhs) {
+					return !(rhs < lhs);
+				}
+
+				/**
+				 * Returns true if lhs is after rhs or the same
+				 */
+				friend bool operator >=(const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs < rhs);
+				}
+
 				/**
 				 * Move this iterator forward by rhs steps
 				 */
@@ -309,6 +762,13 @@ class MyDeque {
 					return lhs += rhs;
 				}
 
+				/**
+				 * Move the iterator rhs forward lhs steps
+				 */
+				friend const_iterator operator +(difference_type lhs, const_iterator rhs) {
+					return rhs += lhs;
+				}
+
 				/**
 				 * Move this iterator back by rhs steps
 				 */
@@ -316,46 +776,45 @@ class MyDeque {
 					return lhs -= rhs;
 				}
 
+				/**
+				 * Returns the number of steps from rhs to lhs, in constant time
+				 */
+				friend difference_type operator -(const const_iterator& lhs, const const_iterator& rhs) {
+					return (lhs.currentRow - rhs.currentRow) * ROW_SIZE +
+							(lhs.currentItem - *lhs.currentRow) - (rhs.currentItem - *rhs.currentRow);
+				}
+
 			private:
-                pointer currentItem;
                 map_pointer currentRow;
-                pointer rowBegin;
-                pointer rowEnd;
+                pointer currentItem;
 
 			private:
                 bool valid() const {
                     if (currentRow == NULL)
                         return false;
-                    if (currentItem < rowBegin)
+                    if (currentItem < *currentRow)
                         return false;
-                    if (currentItem >= rowEnd)
+                    if (currentItem >= *currentRow + ROW_SIZE)
                         return false;
                     return true;
                 }
 
-                void setRow(map_pointer newRow) {
-                    currentRow = newRow;
-                    rowBegin = *newRow;
-                    rowEnd = rowBegin + ROW_SIZE;
-                }
-
 			public:
 				/**
 				 * Create a new const_iterator using a pointer to the data type
 				 * and its row
 				 */
 				const_iterator(pointer item, map_pointer row) :
-                        currentItem(item), currentRow(row), rowBegin(*row), rowEnd(rowBegin + ROW_SIZE) {
-                    assert(valid());
+                        currentRow(row), currentItem(item) {
+                    MYDEQUE_INVARIANT(valid());
                 }
 
                 /**
                  * Create a const_iterator using an iterator
                  */
                 const_iterator(iterator rhs) :
-                        currentItem(rhs.currentItem), currentRow(rhs.currentRow),
-                        rowBegin(rhs.rowBegin), rowEnd(rhs.rowBegin + ROW_SIZE) {
-                    assert(valid());
+                        currentRow(rhs.currentRow), currentItem(rhs.currentItem) {
+                    MYDEQUE_INVARIANT(valid());
                 }
 
 				/**
@@ -372,12 +831,21 @@ class MyDeque {
 					return &**this;
 				}
 
+				/**
+				 * Return the object d steps from the one this iterator points to
+				 */
+				reference operator [](difference_type d) const {
+					return *(*this + d);
+				}
+
 				/**
 				 * Move this iterator forward by 1
 				 */
 				const_iterator& operator ++() {
-                    *this += 1;
-                    assert(valid());
+                    MYDEQUE_INVARIANT(valid());
+                    if (++currentItem == *currentRow + ROW_SIZE)
+                        currentItem = *++currentRow;
+                    MYDEQUE_INVARIANT(valid());
                     return *this;
 				}
 
@@ -388,7 +856,7 @@ class MyDeque {
 				const_iterator operator ++(int) {
 					const_iterator x = *this;
 					++(*this);
-					assert(valid());
+					MYDEQUE_INVARIANT(valid());
 					return x;
 				}
 
@@ -396,8 +864,11 @@ class MyDeque {
 				 * Move this iterator back by 1
 				 */
 				const_iterator& operator --() {
-                    *this += -1;
-                    assert(valid());
+                    MYDEQUE_INVARIANT(valid());
+                    if (currentItem == *currentRow)
+                        currentItem = *--currentRow + ROW_SIZE;
+                    --currentItem;
+                    MYDEQUE_INVARIANT(valid());
                     return *this;
 				}
 
@@ -408,7 +879,7 @@ class MyDeque {
 				const_iterator operator --(int) {
 					const_iterator x = *this;
 					--(*this);
-					assert(valid());
+					MYDEQUE_INVARIANT(valid());
 					return x;
 				}
 
@@ -416,8 +887,8 @@ class MyDeque {
 				 * Move this iterator forward by d steps
 				 */
 				const_iterator& operator +=(difference_type d) {
-                    assert(valid());
-                    difference_type newPosition = d + (currentItem - rowBegin);
+                    MYDEQUE_INVARIANT(valid());
+                    difference_type newPosition = d + (currentItem - *currentRow);
 
                     // Same row
                     if (newPosition >= 0 && newPosition < ROW_SIZE)
@@ -427,10 +898,10 @@ class MyDeque {
                         difference_type newRow = newPosition > 0 ?
                             newPosition / ROW_SIZE :
                             -((-newPosition - 1) / ROW_SIZE) - 1;
-                        setRow(currentRow + newRow);
-                        currentItem = rowBegin + (newPosition - newRow * ROW_SIZE);
+                        currentRow += newRow;
+                        currentItem = *currentRow + (newPosition - newRow * ROW_SIZE);
                     }
-                    assert(valid());
+                    MYDEQUE_INVARIANT(valid());
                     return *this;
 				}
 
@@ -439,7 +910,7 @@ class MyDeque {
 				 */
 				const_iterator& operator -=(difference_type d) {
                     *this += -d;
-                    assert(valid());
+                    MYDEQUE_INVARIANT(valid());
                     return *this;
 				}
 		};
@@ -451,7 +922,7 @@ class MyDeque {
 		friend bool operator ==(const MyDeque& lhs, const MyDeque& rhs) {
             if (lhs.size() != rhs.size())
                 return false;
-			return std::equal(lhs.myBegin, lhs.myEnd, rhs.myBegin);
+			return std::equal(lhs.begin(), lhs.end(), rhs.begin());
 		}
 
 		/**
@@ -460,141 +931,345 @@ class MyDeque {
 		friend bool operator <(const MyDeque& lhs, const MyDeque& rhs) {
             if (lhs.size() < rhs.size())
                 return true;
-            return std::lexicographical_compare(lhs.myBegin, lhs.myEnd,
-                                                rhs.myBegin, rhs.myEnd);
+            return std::lexicographical_compare(lhs.begin(), lhs.end(),
+                                                rhs.begin(), rhs.end());
 		}
 
 	private:
-
-		size_type mySize;
+		// The element at index i lives in slot myStart + i,
+		// counting slots from the start of the first row in the map
+		map_pointer myMap;
 		size_type myMapSize;
-		
+		size_type myStart;
+		size_type mySize;
+
 		allocator_type myAllocator;
 		map_allocator_type myMapAllocator;
-		
-		map_pointer myMap;
 
-        iterator myBegin;
-        iterator myEnd;
+        MyDequeSmallBuffer<value_type, pointer, ROW_SIZE, SmallBuffer> mySmallBuffer;
 
 	private:
 
 		bool valid() const {
-			if (myMap == NULL)
-				return false;
-            if (!myBegin.valid())
-				return false;
-			if (!myEnd.valid())
-				return false;
-			if (myBegin > myEnd)
-				return false;
-            if (myMapSize < 1)
-                return false;
-			return true;
+			return this->validMap();
 		}
 
 		/**
-		 * Helper function to determine if we're at the end of the
-		 * MyDeque yet
+		 * Helper function to find a slot, counting from the start of the map
 		 */
-		 bool atEnd() const {
-		 	bool onLastRow = myEnd.currentRow == myMap + myMapSize - 1;
-		 	bool onLastElementInRow = myEnd.currentItem == myEnd.rowEnd - 1;
-		 	return (onLastRow && onLastElementInRow);
-		 }
+		pointer slotAt(size_type slot) const {
+			return myMap[slot >> LOG_ROW_SIZE] + (slot & (ROW_SIZE - 1));
+		}
+
+		/**
+		 * Helper function to build an iterator to a slot
+		 */
+		iterator iteratorAt(size_type slot) const {
+			return iterator(slotAt(slot), myMap + (slot >> LOG_ROW_SIZE));
+		}
 
 		/**
-		 * Helper function to determine if we're at the end of the
-		 * MyDeque yet
+		 * Helper function to find the index of the element an iterator points to
 		 */
-		 bool atBegin() const {
-		 	return ((myBegin.currentRow == myMap) &&
-		 			(myBegin.currentItem == myBegin.rowBegin));
-		 }
+		size_type indexOf(const iterator& i) const {
+			return (i.currentRow - myMap) * ROW_SIZE + (i.currentItem - *i.currentRow) - myStart;
+		}
+
+		/**
+		 * Helper function to count the slots left in a slot's row
+		 */
+		static size_type rowRemaining(size_type slot) {
+			return ROW_SIZE - (slot & (ROW_SIZE - 1));
+		}
 
         /**
          * Helper function to allocate one row
          */
         pointer allocateRow() {
-            return myAllocator.allocate(ROW_SIZE);
+        	pointer row = mySmallBuffer.takeRow();
+            return row ? row : allocator_traits::allocate(myAllocator, ROW_SIZE);
         }
 
         /**
-         * Helper function to deallocate one row
+         * Helper function to deallocate one row, if there is one
          */
         void deallocateRow(pointer row) {
-        	myAllocator.deallocate(row, ROW_SIZE);
+        	if (row == NULL)
+        		return;
+        	if (mySmallBuffer.ownsRow(row))
+        		mySmallBuffer.giveRow();
+        	else
+        		allocator_traits::deallocate(myAllocator, row, ROW_SIZE);
         }
 
         /**
          * Helper function to allocate a map
          */
         map_pointer allocateMap(size_type n) {
-            return myMapAllocator.allocate(n);
+        	map_pointer map = mySmallBuffer.takeMap(n, myMap);
+            return map ? map : map_allocator_traits::allocate(myMapAllocator, n);
         }
 
         /**
          * Helper function to deallocate a map
          */
         void deallocateMap(map_pointer map, size_type n) {
-            myMapAllocator.deallocate(map, n);
+        	if (!mySmallBuffer.ownsMap(map))
+        		map_allocator_traits::deallocate(myMapAllocator, map, n);
         }
 
         /**
-         * Helper function to initialize the memory
+         * Helper function to move the elements in the row at map slot r
+         * into the row to, which takes that row's place in the map
          */
-         void initMap() {
-         	myMap = allocateMap(1);
-         	*myMap = allocateRow();
-         	myBegin = iterator(*myMap + ROW_SIZE / 2, myMap);
-			myEnd = myBegin;
-			myMapSize = 1;
-         }
+        void moveRow(size_type r, pointer to) {
+        	// Only the slots from myStart to myStart + mySize hold elements
+        	pointer from = myMap[r];
+        	size_type rowStart = r * ROW_SIZE;
+        	size_type first = std::max<size_type>(myStart, rowStart);
+        	size_type last = std::min<size_type>(myStart + mySize, rowStart + ROW_SIZE);
+        	for (size_type i = first; i < last; ++i) {
+        		allocator_traits::construct(myAllocator, to + (i - rowStart), std::move(from[i - rowStart]));
+        		allocator_traits::destroy(myAllocator, from + (i - rowStart));
+        	}
+        	myMap[r] = to;
+        }
 
         /**
-         * Add a row to the back of the array
+         * Move the contents of the small buffer out to the allocator,
+         * so that every row and the map can change owners
+         * Iterators into the small row are invalidated
          */
-         void addRowFront() {
-         	// allocate and initialize the new outer array
-         	map_pointer newMap = allocateMap(myMapSize + 1);
-         	uninitialized_copy(myMapAllocator, myMap, myMap + myMapSize, newMap + 1);
-         	newMap[0] = allocateRow();
-
-         	// Fix iterators
-         	difference_type beginOffset = myBegin.currentRow - myMap + 1;
-         	difference_type endOffset = myEnd.currentRow - myMap + 1;
-         	myBegin.setRow(newMap + beginOffset);
-         	myEnd.setRow(newMap + endOffset);
-
-         	// Destroy the old map
-         	deallocateMap(myMap, myMapSize);
-         	myMap = newMap;
-         	++myMapSize;
-
-         	assert(valid());
-         }
+        void spill() {
+        	for (size_type r = 0; r < myMapSize; ++r) {
+        		if (!mySmallBuffer.ownsRow(myMap[r]))
+        			continue;
+        		moveRow(r, allocator_traits::allocate(myAllocator, ROW_SIZE));
+        		mySmallBuffer.giveRow();
+        	}
+
+        	if (mySmallBuffer.ownsMap(myMap)) {
+        		map_pointer newMap = map_allocator_traits::allocate(myMapAllocator, myMapSize);
+        		uninitialized_copy(myMapAllocator, myMap, myMap + myMapSize, newMap);
+        		myMap = newMap;
+        	}
+
+        	MYDEQUE_INVARIANT(valid());
+        }
+
+        /**
+         * Destroy our elements and give back every row and the map,
+         * leaving this MyDeque with no storage at all
+         */
+        void releaseStorage() {
+        	if (myMap == NULL)
+        		return;
+        	destroySegments(myStart, mySize);
+        	destroyMap();
+        	myMap = NULL;
+        	myMapSize = 0;
+        	myStart = 0;
+        	mySize = 0;
+        }
 
         /**
-         * Add a row to the back of the array
+         * Take over that's rows and map, when this MyDeque has no storage
+         * and its allocator can free that's rows
+         * that is left with a fresh row of its own
+         * With SmallBuffer, elements in that's small row move into ours
+         * instead, so neither deque spills to the allocator
          */
-         void addRowBack() {
-         	// allocate and initialize the new outer array
-         	map_pointer newMap = allocateMap(myMapSize + 1);
-         	uninitialized_copy(myMapAllocator, myMap, myMap + myMapSize, newMap);
-         	newMap[myMapSize] = allocateRow();
-
-         	// Fix iterators
-         	difference_type beginOffset = myBegin.currentRow - myMap;
-         	difference_type endOffset = myEnd.currentRow - myMap;
-         	myBegin.setRow(newMap + beginOffset);
-         	myEnd.setRow(newMap + endOffset);
-
-         	// Destroy the old map
-         	deallocateMap(myMap, myMapSize);
-         	myMap = newMap;
-         	++myMapSize;
-
-         	assert(valid());
+        void takeStorage(MyDeque& that) {
+        	if (!SmallBuffer) {
+        		initMap();
+        		swapStorage(that);
+        		return;
+        	}
+
+        	myMap = that.myMap;
+        	myMapSize = that.myMapSize;
+        	myStart = that.myStart;
+        	mySize = that.mySize;
+        	if (that.mySmallBuffer.ownsMap(that.myMap)) {
+        		myMap = mySmallBuffer.takeMap(myMapSize, NULL);
+        		std::copy(that.myMap, that.myMap + myMapSize, myMap);
+        	}
+        	for (size_type r = 0; r < myMapSize; ++r) {
+        		if (!that.mySmallBuffer.ownsRow(myMap[r]))
+        			continue;
+        		moveRow(r, mySmallBuffer.takeRow());
+        		that.mySmallBuffer.giveRow();
+        	}
+
+        	// that's small row and map are free again, so this never allocates
+        	that.myMap = NULL;
+        	that.mySize = 0;
+        	that.initMap();
+        }
+
+        /**
+         * Move rhs's elements into this MyDeque, leaving rhs empty,
+         * when our allocator can free rhs's rows
+         */
+        void moveStorage(MyDeque& rhs) {
+        	if (SmallBuffer) {
+        		releaseStorage();
+        		takeStorage(rhs);
+        	}
+        	else {
+        		swapStorage(rhs);
+        		rhs.clear();
+        	}
+        }
+
+        /**
+         * Append n elements read from b, one row segment at a time
+         */
+        template<typename II>
+        void appendCount(II b, size_type n) {
+        	reserveBack(n);
+        	while (n > 0) {
+        		size_type slot = myStart + mySize;
+        		size_type count = std::min<size_type>(n, rowRemaining(slot));
+        		II e = b;
+        		std::advance(e, count);
+        		uninitialized_copy_segment(myAllocator, b, e, slotAt(slot));
+        		b = e;
+        		n -= count;
+        		// Only claim the segment once it has been fully constructed
+        		mySize += count;
+        	}
+        	MYDEQUE_INVARIANT(valid());
+        }
+
+        /**
+         * Prepend n elements read from b, one row segment at a time,
+         * keeping them in the order they were read
+         */
+        template<typename II>
+        void prependCount(II b, size_type n) {
+        	reserveFront(n);
+        	size_type first = myStart - n;
+        	size_type done = 0;
+        	try {
+        		while (done < n) {
+        			size_type slot = first + done;
+        			size_type count = std::min<size_type>(n - done, rowRemaining(slot));
+        			II e = b;
+        			std::advance(e, count);
+        			uninitialized_copy_segment(myAllocator, b, e, slotAt(slot));
+        			b = e;
+        			done += count;
+        		}
+        	}
+        	catch (...) {
+        		destroySegments(first, done);
+        		throw;
+        	}
+        	myStart = first;
+        	mySize += n;
+        	MYDEQUE_INVARIANT(valid());
+        }
+
+        template<typename II>
+        void appendRange(II b, II e, std::input_iterator_tag) {
+        	while (b != e) {
+        		push_back(*b);
+        		++b;
+        	}
+        }
+
+        template<typename II>
+        void appendRange(II b, II e, std::forward_iterator_tag) {
+        	appendCount(b, std::distance(b, e));
+        }
+
+        template<typename II>
+        void prependRange(II b, II e, std::input_iterator_tag) {
+        	// The size isn't known up front, so stage the elements first
+        	MyDeque tmp(myAllocator);
+        	tmp.append(b, e);
+        	prependCount(tmp.begin(), tmp.mySize);
+        }
+
+        template<typename II>
+        void prependRange(II b, II e, std::forward_iterator_tag) {
+        	prependCount(b, std::distance(b, e));
+        }
+
+        /**
+         * Destroy the n elements starting at a slot, one row segment at a time
+         */
+        void destroySegments(size_type slot, size_type n) {
+        	if (std::is_trivially_destructible<value_type>::value)
+        		return;
+        	while (n > 0) {
+        		size_type count = std::min<size_type>(n, rowRemaining(slot));
+        		pointer p = slotAt(slot);
+        		destroy(myAllocator, p, p + count);
+        		n -= count;
+        		slot += count;
+        	}
+        }
+
+        /**
+         * Exchange rows and maps with another MyDeque, leaving the allocators
+         * With SmallBuffer, elements in the small row first move to the heap
+         */
+        void swapStorage(MyDeque& other) {
+        	// Storage inside either object can't be handed over
+        	if (SmallBuffer) {
+        		spill();
+        		other.spill();
+        	}
+        	std::swap(myMap, other.myMap);
+        	std::swap(myMapSize, other.myMapSize);
+        	std::swap(myStart, other.myStart);
+        	std::swap(mySize, other.mySize);
+        }
+
+        // The allocator_traits propagate_on_container_* flags pick among these
+        // at compile time, so allocators that can't be assigned, like
+        // std::pmr::polymorphic_allocator, are never assigned
+
+        void swapAllocators(MyDeque&, std::false_type) {}
+
+        void swapAllocators(MyDeque& other, std::true_type) {
+        	std::swap(myAllocator, other.myAllocator);
+        	std::swap(myMapAllocator, other.myMapAllocator);
+        }
+
+        void copyAssign(const MyDeque& rhs, std::false_type) {
+        	assign(rhs.begin(), rhs.end());
+        }
+
+        void copyAssign(const MyDeque& rhs, std::true_type) {
+        	if (myAllocator == rhs.myAllocator) {
+        		myAllocator = rhs.myAllocator;
+        		myMapAllocator = rhs.myMapAllocator;
+        		assign(rhs.begin(), rhs.end());
+        		return;
+        	}
+        	// Our rows have to go back to the allocator they came from,
+        	// so copy with rhs's allocator and let tmp free them with ours
+        	MyDeque tmp(rhs, rhs.myAllocator);
+        	swapAllocators(tmp, std::true_type());
+        	swapStorage(tmp);
+        }
+
+        void moveAssign(MyDeque& rhs, std::true_type) {
+        	// Our rows have to go back to our allocator before it is replaced
+        	if (SmallBuffer)
+        		releaseStorage();
+        	swapAllocators(rhs, std::true_type());
+        	moveStorage(rhs);
+        }
+
+        void moveAssign(MyDeque& rhs, std::false_type) {
+        	if (myAllocator == rhs.myAllocator)
+        		moveStorage(rhs);
+        	else
+        		assign(std::make_move_iterator(rhs.begin()), std::make_move_iterator(rhs.end()));
         }
 
 	public:
@@ -603,13 +1278,14 @@ class MyDeque {
 		 * has a minimum 1 row
 		 */
 		explicit MyDeque(const allocator_type& a = allocator_type()) :
-				mySize(0),
+				myMap(NULL),
 				myMapSize(0),
+				myStart(0),
+				mySize(0),
 				myAllocator(a),
-				myMapAllocator(),
-				myMap(NULL) {
+				myMapAllocator(a) {
 			initMap();
-			assert(valid());
+			MYDEQUE_INVARIANT(valid());
 		}
 
 		/**
@@ -617,30 +1293,85 @@ class MyDeque {
 		 * values. Minimum one row
 		 */
 		explicit MyDeque(size_type s, const_reference v = value_type(), const allocator_type& a = allocator_type()) :
-				mySize(0),
+				myMap(NULL),
 				myMapSize(0),
+				myStart(0),
+				mySize(0),
 				myAllocator(a),
-				myMapAllocator(),
-				myMap(NULL) {
+				myMapAllocator(a) {
 			initMap();
 			for (size_type i = 0; i < s; ++i)
 				push_back(v);
-			assert(valid());
+			MYDEQUE_INVARIANT(valid());
 		}
 
 		/**
 		 * Copy construct this MyDeque using another
+		 * The allocator is whatever select_on_container_copy_construction picks
 		 */
 		MyDeque(const MyDeque& that) :
+				myMap(NULL),
+				myMapSize(0),
+				myStart(0),
 				mySize(0),
+				myAllocator(allocator_traits::select_on_container_copy_construction(that.myAllocator)),
+				myMapAllocator(myAllocator) {
+			initMap();
+			appendCount(that.begin(), that.mySize);
+            MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Copy construct this MyDeque using another and the allocator a
+		 */
+		MyDeque(const MyDeque& that, const allocator_type& a) :
+				myMap(NULL),
 				myMapSize(0),
-				myAllocator(that.myAllocator),
-				myMapAllocator(that.myMapAllocator),
-				myMap(NULL) {
+				myStart(0),
+				mySize(0),
+				myAllocator(a),
+				myMapAllocator(a) {
 			initMap();
-			for (iterator i = that.myBegin; i < that.myEnd; ++i)
-				push_back(*i);
-            assert(valid());
+			appendCount(that.begin(), that.mySize);
+            MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Move construct this MyDeque from another in constant time,
+		 * taking over its rows and map
+		 * Like std::deque, that is left with a fresh row of its own
+		 * With SmallBuffer, a deque that fits in its small row stays inline
+		 */
+		MyDeque(MyDeque&& that) :
+				myMap(NULL),
+				myMapSize(0),
+				myStart(0),
+				mySize(0),
+				myAllocator(that.myAllocator),
+				myMapAllocator(that.myMapAllocator) {
+			takeStorage(that);
+            MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Move construct this MyDeque from another using the allocator a
+		 * The rows change hands only if a equals that's allocator,
+		 * otherwise the elements are moved one at a time
+		 */
+		MyDeque(MyDeque&& that, const allocator_type& a) :
+				myMap(NULL),
+				myMapSize(0),
+				myStart(0),
+				mySize(0),
+				myAllocator(a),
+				myMapAllocator(a) {
+			if (myAllocator == that.myAllocator)
+				takeStorage(that);
+			else {
+				initMap();
+				appendCount(std::make_move_iterator(that.begin()), that.mySize);
+			}
+            MYDEQUE_INVARIANT(valid());
 		}
 
 		/**
@@ -648,18 +1379,32 @@ class MyDeque {
 		 */
 		~MyDeque() {
 			// Clear our data
-            destroy(myAllocator, myBegin, myEnd);
+            destroySegments(myStart, mySize);
             // Now deallocate the rows and the map
-            for (map_pointer i = myMap; i < myMap + myMapSize; ++i)
-            	deallocateRow(*i);
-            deallocateMap(myMap, myMapSize);
+            destroyMap();
 		}
 
 		/**
 		 * Set this MyDeque equal to another
+		 * The allocator follows propagate_on_container_copy_assignment
 		 */
-		MyDeque& operator =(MyDeque rhs) {
-            swap(rhs);
+		MyDeque& operator =(const MyDeque& rhs) {
+			if (this != &rhs)
+				copyAssign(rhs, typename allocator_traits::propagate_on_container_copy_assignment());
+			MYDEQUE_INVARIANT(valid());
+			return *this;
+		}
+
+		/**
+		 * Move another MyDeque into this one
+		 * The rows change hands in constant time when the allocator propagates
+		 * on move assignment or the allocators are equal, otherwise the
+		 * elements are moved one at a time
+		 */
+		MyDeque& operator =(MyDeque&& rhs) {
+			if (this != &rhs)
+				moveAssign(rhs, typename allocator_traits::propagate_on_container_move_assignment());
+			MYDEQUE_INVARIANT(valid());
 			return *this;
 		}
 
@@ -667,7 +1412,8 @@ class MyDeque {
 		 * Index this MyDeque, return the indexth element
 		 */
 		reference operator [](size_type index) {
-            return *(myBegin + index);
+			MYDEQUE_CHECK(index < mySize);
+            return *slotAt(myStart + index);
 		}
 
 		/**
@@ -681,9 +1427,9 @@ class MyDeque {
 		 * Gets the indexth element from the MyDeque
 		 */
 		reference at(size_type index) {
-			if (index < 0 || index > mySize)
+			if (index >= mySize)
 				throw std::out_of_range("index out of range");
-			return *(myBegin + index);
+			return *slotAt(myStart + index);
 		}
 
 		/**
@@ -693,11 +1439,61 @@ class MyDeque {
 			return const_cast<MyDeque*>(this)->at(index);
 		}
 
+		/**
+		 * Append the elements in [b, e) to the end of this MyDeque
+		 * Forward ranges add all the rows they need at once
+		 */
+		template<typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type append(II b, II e) {
+			appendRange(b, e, typename std::iterator_traits<II>::iterator_category());
+		}
+
+		/**
+		 * Append the n elements of a contiguous buffer to the end of this MyDeque
+		 * Trivially copyable elements are copied a whole row slice at a time
+		 */
+		void append(const_pointer p, size_type n) {
+			appendCount(p, n);
+		}
+
+		/**
+		 * Replace the contents of this MyDeque with the elements in [b, e)
+		 * Integers aren't iterators, so assign(3, 7) means three sevens
+		 */
+		template<typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type assign(II b, II e) {
+			clear();
+			append(b, e);
+		}
+
+		/**
+		 * Replace the contents of this MyDeque with n copies of v
+		 * The elements we keep are assigned to, so v may be one of them
+		 */
+		void assign(size_type n, const_reference v) {
+			size_type kept = std::min(n, mySize);
+			std::fill(begin(), begin() + kept, v);
+			if (n < mySize)
+				pop_back(mySize - n);
+			for (size_type i = kept; i < n; ++i)
+				push_back(v);
+		}
+
+		/**
+		 * Replace the contents of this MyDeque with the n elements
+		 * of a contiguous buffer
+		 */
+		void assign(const_pointer p, size_type n) {
+			clear();
+			append(p, n);
+		}
+
 		/**
 		 * Returns the last element in the MyDeque
 		 */
 		reference back() {
-            return *(myEnd - 1);
+			MYDEQUE_CHECK(!empty());
+            return *slotAt(myStart + mySize - 1);
 		}
 
 		/**
@@ -711,23 +1507,25 @@ class MyDeque {
 		 * Returns the first element in the MyDeque
 		 */
 		iterator begin() {
-            return myBegin;
+            return iteratorAt(myStart);
 		}
 
 		/**
 		 * Returns the first element in the MyDeque
 		 */
 		const_iterator begin() const {
-            return begin();
+            return iteratorAt(myStart);
 		}
 
 		/**
-		 * Delete all data from the MyDeque
+		 * Delete all data from the MyDeque, deallocating every row but one
+		 * Like std::deque, the map keeps its size, so clear() never allocates
+		 * The row left is moved to the middle of the map, with room to
+		 * grow toward either end
 		 */
 		void clear() {
-			while(mySize > 0)
-				pop_back();
-			assert(valid());
+			destroySegments(myStart, mySize);
+			clearRows();
 		}
 
 		/**
@@ -742,40 +1540,42 @@ class MyDeque {
 		 * Returns an iterator to the space after the last element
 		 */
 		iterator end() {
-            return myEnd;
+            return iteratorAt(myStart + mySize);
 		}
 
 		/**
 		 * Returns an iterator to the space after the last element
 		 */
 		const_iterator end() const {
-            return end();
+            return iteratorAt(myStart + mySize);
 		}
 
 		/**
 		 * Remove the element pointed to by i
+		 * Whichever side of i is shorter shifts over by one
+		 * Returns an iterator to the element after the one removed
 		 */
 		iterator erase(iterator i) {
-			if (i == myBegin) {
+			MYDEQUE_CHECK(i != end());
+			size_type index = indexOf(i);
+			if (index < mySize / 2) {
+				std::move_backward(begin(), i, i + 1);
 				pop_front();
-				return myBegin;
 			}
-			else if (i == myEnd) {
+			else {
+				std::move(i + 1, end(), i);
 				pop_back();
-				return myEnd;
 			}
-			iterator j = i + 1;
-			*i = *j;
-			erase(j);
-			assert(valid());
-			return i;
+			MYDEQUE_INVARIANT(valid());
+			return iteratorAt(myStart + index);
 		}
 
 		/**
 		 * Returns the first element in this Deque
 		 */
 		reference front() {
-            return *myBegin;
+			MYDEQUE_CHECK(!empty());
+            return *slotAt(myStart);
 		}
 
 		/**
@@ -786,70 +1586,173 @@ class MyDeque {
 		}
 
 		/**
-		 * Insert an element into this iterator
+		 * Returns a copy of the allocator the elements come from
+		 */
+		allocator_type get_allocator() const {
+			return myAllocator;
+		}
+
+		/**
+		 * Insert an element before the one i points to
+		 * Whichever side of i is shorter shifts over by one
+		 * Returns an iterator to the new element
 		 */
 		iterator insert(iterator i , const_reference v) {
-			if (i == myBegin) {
-				push_front(v);
-				return myBegin;
+			size_type index = indexOf(i);
+			// v may live in this deque, where shifting would overwrite it
+			value_type tmp(v);
+			if (index == mySize)
+				push_back(tmp);
+			else if (index < mySize / 2) {
+				// Rows never move, so front() stays put while the map grows
+				push_front(front());
+				iterator b = begin();
+				std::move(b + 1, b + (index + 1), b);
+				*(b + index) = std::move(tmp);
 			}
-			else if (i == myEnd) {
-				push_back(v);
-				return myEnd;
+			else {
+				push_back(back());
+				iterator b = begin();
+				std::move_backward(b + index, b + (mySize - 2), b + (mySize - 1));
+				*(b + index) = std::move(tmp);
 			}
-			const_reference tmp = *i;
-			*i = v;
-			insert(i + 1, tmp);
-			assert(valid());
-			return i;
+			MYDEQUE_INVARIANT(valid());
+			return iteratorAt(myStart + index);
+		}
+
+		/**
+		 * Insert the elements in [b, e) at the front of this MyDeque,
+		 * keeping their order
+		 */
+		template<typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type prepend(II b, II e) {
+			prependRange(b, e, typename std::iterator_traits<II>::iterator_category());
+		}
+
+		/**
+		 * Insert the n elements of a contiguous buffer at the front of
+		 * this MyDeque, keeping their order
+		 */
+		void prepend(const_pointer p, size_type n) {
+			prependCount(p, n);
 		}
 
 		/**
 		 * Remove the last element in this MyDeque
 		 */
 		void pop_back() {
+			MYDEQUE_CHECK(!empty());
 			--mySize;
-			--myEnd;
-			myAllocator.destroy(&*myEnd);
-			assert(valid());
+			allocator_traits::destroy(myAllocator, slotAt(myStart + mySize));
+			MYDEQUE_INVARIANT(valid());
 		}
 
 		/**
 		 * Remove the first element in this MyDeque
 		 */
 		void pop_front() {
+			MYDEQUE_CHECK(!empty());
+			allocator_traits::destroy(myAllocator, slotAt(myStart));
+			++myStart;
 			--mySize;
-			myAllocator.destroy(&*myBegin);
-			++myBegin;
-			assert(valid());
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Remove the last n elements in this MyDeque
+		 * Rows left empty stay in the map as spares, like they do
+		 * after single pops, so pushing back again allocates nothing
+		 */
+		void pop_back(size_type n) {
+			MYDEQUE_CHECK(n <= mySize);
+			destroySegments(myStart + mySize - n, n);
+			mySize -= n;
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Remove the first n elements in this MyDeque
+		 * Rows left empty stay in the map as spares, for either end to reuse
+		 */
+		void pop_front(size_type n) {
+			MYDEQUE_CHECK(n <= mySize);
+			destroySegments(myStart, n);
+			myStart += n;
+			mySize -= n;
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Move the first n elements in this MyDeque into x, then remove them
+		 * Elements are moved one row segment at a time, so a contiguous
+		 * output of a trivially copyable type gets one memcpy per row
+		 * Returns the end of the output
+		 */
+		template<typename OI>
+		OI drain_front(size_type n, OI x) {
+			MYDEQUE_CHECK(n <= mySize);
+			size_type slot = myStart;
+			size_type left = n;
+			while (left > 0) {
+				size_type count = std::min<size_type>(left, rowRemaining(slot));
+				pointer p = slotAt(slot);
+				x = move_segment(p, p + count, x);
+				left -= count;
+				slot += count;
+			}
+			pop_front(n);
+			return x;
 		}
 
 		/**
 		 * Append an element the end of this MyDeque
 		 */
 		void push_back(const_reference v) {
-			assert(valid());
-            if(atEnd()) {
-                addRowBack();
-            }
-            myAllocator.construct(&*myEnd, v);
-            assert(myEnd.valid());
-            ++myEnd;
+			MYDEQUE_INVARIANT(valid());
+            // Only the first element of a row needs a new row for end()
+            if (((myStart + mySize + 1) & (ROW_SIZE - 1)) == 0)
+                reserveBack(1);
+            allocator_traits::construct(myAllocator, slotAt(myStart + mySize), v);
+			++mySize;
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Move an element onto the end of this MyDeque
+		 */
+		void push_back(value_type&& v) {
+			MYDEQUE_INVARIANT(valid());
+			if (((myStart + mySize + 1) & (ROW_SIZE - 1)) == 0)
+				reserveBack(1);
+			allocator_traits::construct(myAllocator, slotAt(myStart + mySize), std::move(v));
 			++mySize;
-			assert(valid());
+			MYDEQUE_INVARIANT(valid());
 		}
 
 		/**
 		 * Append an element to the front of this MyDeque
 		 */
 		void push_front(const_reference v) {
-			assert(valid());
-            if(atBegin())
-                addRowFront();
-            --myBegin;
-            myAllocator.construct(&*myBegin, v);
+			MYDEQUE_INVARIANT(valid());
+            if ((myStart & (ROW_SIZE - 1)) == 0)
+                reserveFront(1);
+            allocator_traits::construct(myAllocator, slotAt(myStart - 1), v);
+            --myStart;
+			++mySize;
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Move an element onto the front of this MyDeque
+		 */
+		void push_front(value_type&& v) {
+			MYDEQUE_INVARIANT(valid());
+			if ((myStart & (ROW_SIZE - 1)) == 0)
+				reserveFront(1);
+			allocator_traits::construct(myAllocator, slotAt(myStart - 1), std::move(v));
+			--myStart;
 			++mySize;
-			assert(valid());
+			MYDEQUE_INVARIANT(valid());
 		}
 
 		/**
@@ -864,10 +1767,18 @@ class MyDeque {
 			while (mySize < s) {
 				push_back(v);
 			}
-			while(mySize > s) {
-				pop_back();
-			}
-			assert(valid());
+			if (mySize > s)
+				pop_back(mySize - s);
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Deallocate the spare rows and shrink the map to the rows
+		 * holding elements, with the one end() points at
+		 * Iterators stay valid, since no element moves
+		 */
+		void shrink_to_fit() {
+			releaseRows(myStart >> LOG_ROW_SIZE, ((myStart + mySize) >> LOG_ROW_SIZE) + 1);
 		}
 
 		/**
@@ -879,22 +1790,23 @@ class MyDeque {
 
 		/**
 		 * Swap the contents of this deque and another
+		 * With SmallBuffer, elements in the small row first move to the heap
 		 */
 		void swap(MyDeque& other) {
-			if (myAllocator == other.myAllocator) {
-				std::swap(myMap, other.myMap);
-				std::swap(myMapSize, other.myMapSize);
-				std::swap(myBegin, other.myBegin);
-				std::swap(myEnd, other.myEnd);
-				std::swap(mySize, other.mySize);
-			}
-			else {
-				// This will do the slow call
-				// using a temporary storage MyDeque
-				std::swap(*this, other);
-			}
+			// Like std::deque, swapping unequal allocators that don't
+			// propagate on swap is undefined, so it's only checked
+			if (!allocator_traits::propagate_on_container_swap::value)
+				MYDEQUE_CHECK(myAllocator == other.myAllocator);
+			swapAllocators(other, typename allocator_traits::propagate_on_container_swap());
+			swapStorage(other);
+			MYDEQUE_INVARIANT(valid());
+		}
 
-			assert(valid());
+		/**
+		 * Swap the contents of two deques
+		 */
+		friend void swap(MyDeque& lhs, MyDeque& rhs) {
+			lhs.swap(rhs);
 		}
 };
 
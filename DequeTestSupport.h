@@ -0,0 +1,83 @@
+// -----------------------------------
+// projects/deque/DequeTestSupport.h
+// -----------------------------------
+
+#ifndef DequeTestSupport_h
+#define DequeTestSupport_h
+
+#if __cplusplus > 201703L
+#include <coroutine> // suspend_never
+#include <exception> // terminate
+#endif
+
+// What the test and benchmark programs have in common
+// The tests check every container against a std::deque put through the
+// same operations, with inputs from Samples
+
+/**
+ * Small deterministic generator, so failures can be replayed
+ * and every benchmark run sees the same inputs
+ * It's a 64 bit LCG, whose low bits repeat quickly, so values come from the top
+ */
+class Samples {
+	private:
+		unsigned long state;
+
+	public:
+		explicit Samples(unsigned long seed) : state(seed) {}
+
+		/**
+		 * Step the generator and return the whole state
+		 */
+		unsigned long bits() {
+			state = state * 6364136223846793005UL + 1442695040888963407UL;
+			return state;
+		}
+
+		/**
+		 * Returns a value in [0, limit)
+		 */
+		template<typename T>
+		T next(T limit) {
+			return static_cast<T>((bits() >> 33) % limit);
+		}
+};
+
+/**
+ * Keeps the optimizer from dropping the work we're timing,
+ * whatever it computed is assigned to sink()
+ */
+inline volatile long& sink() {
+	static volatile long value;
+	return value;
+}
+
+#if __cplusplus > 201703L
+/**
+ * The least a coroutine needs to run: it starts right away
+ * and frees itself when it finishes
+ */
+struct Task {
+	struct promise_type {
+		Task get_return_object() {
+			return Task();
+		}
+
+		std::suspend_never initial_suspend() {
+			return std::suspend_never();
+		}
+
+		std::suspend_never final_suspend() noexcept {
+			return std::suspend_never();
+		}
+
+		void return_void() {}
+
+		void unhandled_exception() {
+			std::terminate();
+		}
+	};
+};
+#endif
+
+#endif // DequeTestSupport_h
@@ -0,0 +1,635 @@
+// ----------------------------
+// projects/deque/DequeTrace.h
+// ----------------------------
+
+#ifndef DequeTrace_h
+#define DequeTrace_h
+
+#include <algorithm>   // move
+#include <cstddef>     // ptrdiff_t, size_t
+#include <istream>     // istream
+#include <iterator>    // forward_iterator_tag, output_iterator_tag
+#include <memory>      // allocator
+#include <ostream>     // ostream
+#include <stdexcept>   // runtime_error
+#include <string>      // string
+#include <type_traits> // enable_if, is_integral
+#include <utility>     // move
+
+#include "Deque.h"
+
+// A trace is the header
+//     "MDQT", the format version, the element size as a varint
+// then one record per operation
+//     the op code, then the op's argument as a varint, if it has one
+// Argument-free ops repeated back to back collapse into one record, with
+// RUN set in the op code and the repeat count as a varint
+// Varints are LEB128: 7 bits a byte, low bits first, high bit set on all but the last
+
+enum DequeTraceOp {
+	TRACE_PUSH_BACK,   // no argument
+	TRACE_PUSH_FRONT,  // no argument
+	TRACE_POP_BACK,    // no argument
+	TRACE_POP_FRONT,   // no argument
+	TRACE_CLEAR,       // no argument
+	TRACE_POP_BACK_N,  // the count
+	TRACE_POP_FRONT_N, // the count
+	TRACE_RESIZE,      // the new size
+	TRACE_INDEX,       // the index read or written
+	TRACE_INSERT,      // the index inserted before
+	TRACE_ERASE,       // the index erased
+	TRACE_PHASE,       // the name's length, then the name
+	// Later ops go last, so older traces keep their codes
+	TRACE_APPEND,      // the count
+	TRACE_PREPEND,     // the count
+	TRACE_ASSIGN,      // the new size
+	TRACE_DRAIN_FRONT, // the count
+	TRACE_OP_COUNT
+};
+
+const unsigned int TRACE_VERSION = 1;
+const unsigned char TRACE_RUN = 0x80;
+
+/**
+ * Returns true if op is recorded without an argument
+ */
+inline bool trace_op_is_bare(DequeTraceOp op) {
+	return op <= TRACE_CLEAR;
+}
+
+/**
+ * One record read back from a trace
+ * count is the repeat count for bare ops and 1 otherwise
+ */
+struct DequeTraceRecord {
+	DequeTraceOp op;
+	std::size_t count;
+	std::size_t argument;
+	std::string phase;
+};
+
+/**
+ * Writes a trace to a stream
+ */
+class DequeTraceWriter {
+	private:
+		std::ostream& myOut;
+
+		// The run of bare ops not written yet
+		DequeTraceOp myPending;
+		std::size_t myPendingCount;
+
+	private:
+		void writeVarint(std::size_t v) {
+			while (v >= 0x80) {
+				myOut.put(static_cast<char>((v & 0x7f) | 0x80));
+				v >>= 7;
+			}
+			myOut.put(static_cast<char>(v));
+		}
+
+	public:
+		/**
+		 * Start a trace of elements elementSize bytes big
+		 */
+		DequeTraceWriter(std::ostream& out, std::size_t elementSize) :
+				myOut(out),
+				myPending(TRACE_PUSH_BACK),
+				myPendingCount(0) {
+			myOut.write("MDQT", 4);
+			writeVarint(TRACE_VERSION);
+			writeVarint(elementSize);
+		}
+
+		~DequeTraceWriter() {
+			flush();
+		}
+
+		/**
+		 * Record an op that takes no argument
+		 */
+		void bare(DequeTraceOp op) {
+			if (myPendingCount > 0 && myPending != op)
+				flush();
+			myPending = op;
+			++myPendingCount;
+		}
+
+		/**
+		 * Record an op and its argument
+		 */
+		void withArgument(DequeTraceOp op, std::size_t argument) {
+			flush();
+			myOut.put(static_cast<char>(op));
+			writeVarint(argument);
+		}
+
+		/**
+		 * Record the start of a phase, so replay can report it on its own
+		 */
+		void phase(const std::string& name) {
+			flush();
+			myOut.put(static_cast<char>(TRACE_PHASE));
+			writeVarint(name.size());
+			myOut.write(name.data(), name.size());
+		}
+
+		/**
+		 * Write out the pending run
+		 */
+		void flush() {
+			if (myPendingCount == 1)
+				myOut.put(static_cast<char>(myPending));
+			else if (myPendingCount > 1) {
+				myOut.put(static_cast<char>(myPending | TRACE_RUN));
+				writeVarint(myPendingCount);
+			}
+			myPendingCount = 0;
+		}
+};
+
+/**
+ * Reads a trace back from a stream
+ * Throws std::runtime_error on anything that isn't a well formed trace
+ */
+class DequeTraceReader {
+	private:
+		std::istream& myIn;
+		std::size_t myElementSize;
+
+	private:
+		std::size_t readVarint() {
+			std::size_t v = 0;
+			for (unsigned int shift = 0; ; shift += 7) {
+				int c = myIn.get();
+				if (c == std::istream::traits_type::eof() || shift >= 8 * sizeof(std::size_t))
+					throw std::runtime_error("truncated trace");
+				v |= static_cast<std::size_t>(c & 0x7f) << shift;
+				if (!(c & 0x80))
+					return v;
+			}
+		}
+
+	public:
+		explicit DequeTraceReader(std::istream& in) : myIn(in), myElementSize(0) {
+			char magic[4];
+			if (!myIn.read(magic, 4) || std::string(magic, 4) != "MDQT")
+				throw std::runtime_error("not a MyDeque trace");
+			if (readVarint() != TRACE_VERSION)
+				throw std::runtime_error("unsupported trace version");
+			myElementSize = readVarint();
+		}
+
+		/**
+		 * Returns the size of the elements the trace was recorded with
+		 */
+		std::size_t elementSize() const {
+			return myElementSize;
+		}
+
+		/**
+		 * Read the next record into r
+		 * Returns false at the end of the trace
+		 */
+		bool next(DequeTraceRecord& r) {
+			int c = myIn.get();
+			if (c == std::istream::traits_type::eof())
+				return false;
+
+			r.op = static_cast<DequeTraceOp>(c & ~TRACE_RUN);
+			if (r.op >= TRACE_OP_COUNT)
+				throw std::runtime_error("unknown trace op");
+			r.count = 1;
+			r.argument = 0;
+			r.phase.clear();
+
+			if (c & TRACE_RUN) {
+				if (!trace_op_is_bare(r.op))
+					throw std::runtime_error("run of an op with an argument");
+				r.count = readVarint();
+			}
+			else if (r.op == TRACE_PHASE) {
+				r.phase.resize(readVarint());
+				if (!myIn.read(&r.phase[0], r.phase.size()))
+					throw std::runtime_error("truncated trace");
+			}
+			else if (!trace_op_is_bare(r.op))
+				r.argument = readVarint();
+			return true;
+		}
+};
+
+/**
+ * A MyDeque that records every operation it sees to a DequeTraceWriter
+ * Opt in by using it in place of MyDeque where the workload comes from
+ * Only the shape of the workload is recorded, never the element values,
+ * and reads through iterators aren't recorded
+ * Range operations are recorded once they finish, with the count they
+ * added, since an input range can't be counted beforehand
+ */
+template<typename T, typename A = std::allocator<T> >
+class RecordingDeque {
+	public:
+		typedef MyDeque<T, A> deque_type;
+		typedef typename deque_type::value_type value_type;
+		typedef typename deque_type::size_type size_type;
+		typedef typename deque_type::reference reference;
+		typedef typename deque_type::const_reference const_reference;
+		typedef typename deque_type::const_pointer const_pointer;
+		typedef typename deque_type::iterator iterator;
+		typedef typename deque_type::const_iterator const_iterator;
+
+	private:
+		deque_type myDeque;
+		DequeTraceWriter& myTrace;
+
+	public:
+		explicit RecordingDeque(DequeTraceWriter& trace, const A& a = A()) :
+				myDeque(a),
+				myTrace(trace) {}
+
+		/**
+		 * Returns the deque itself, whose operations aren't recorded
+		 */
+		const deque_type& deque() const {
+			return myDeque;
+		}
+
+		/**
+		 * Start a new phase in the trace
+		 */
+		void phase(const std::string& name) {
+			myTrace.phase(name);
+		}
+
+		reference operator [](size_type index) {
+			myTrace.withArgument(TRACE_INDEX, index);
+			return myDeque[index];
+		}
+
+		const_reference operator [](size_type index) const {
+			myTrace.withArgument(TRACE_INDEX, index);
+			return myDeque[index];
+		}
+
+		template<typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type append(II b, II e) {
+			size_type before = myDeque.size();
+			myDeque.append(b, e);
+			myTrace.withArgument(TRACE_APPEND, myDeque.size() - before);
+		}
+
+		void append(const_pointer p, size_type n) {
+			myTrace.withArgument(TRACE_APPEND, n);
+			myDeque.append(p, n);
+		}
+
+		template<typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type assign(II b, II e) {
+			myDeque.assign(b, e);
+			myTrace.withArgument(TRACE_ASSIGN, myDeque.size());
+		}
+
+		void assign(const_pointer p, size_type n) {
+			myTrace.withArgument(TRACE_ASSIGN, n);
+			myDeque.assign(p, n);
+		}
+
+		void assign(size_type n, const_reference v) {
+			myTrace.withArgument(TRACE_ASSIGN, n);
+			myDeque.assign(n, v);
+		}
+
+		reference back() {
+			myTrace.withArgument(TRACE_INDEX, myDeque.size() - 1);
+			return myDeque.back();
+		}
+
+		iterator begin() {
+			return myDeque.begin();
+		}
+
+		const_iterator begin() const {
+			return myDeque.begin();
+		}
+
+		void clear() {
+			myTrace.bare(TRACE_CLEAR);
+			myDeque.clear();
+		}
+
+		template<typename OI>
+		OI drain_front(size_type n, OI x) {
+			myTrace.withArgument(TRACE_DRAIN_FRONT, n);
+			return myDeque.drain_front(n, x);
+		}
+
+		bool empty() const {
+			return myDeque.empty();
+		}
+
+		iterator end() {
+			return myDeque.end();
+		}
+
+		const_iterator end() const {
+			return myDeque.end();
+		}
+
+		iterator erase(iterator i) {
+			myTrace.withArgument(TRACE_ERASE, i - myDeque.begin());
+			return myDeque.erase(i);
+		}
+
+		reference front() {
+			myTrace.withArgument(TRACE_INDEX, 0);
+			return myDeque.front();
+		}
+
+		iterator insert(iterator i, const_reference v) {
+			myTrace.withArgument(TRACE_INSERT, i - myDeque.begin());
+			return myDeque.insert(i, v);
+		}
+
+		void pop_back() {
+			myTrace.bare(TRACE_POP_BACK);
+			myDeque.pop_back();
+		}
+
+		void pop_back(size_type n) {
+			myTrace.withArgument(TRACE_POP_BACK_N, n);
+			myDeque.pop_back(n);
+		}
+
+		void pop_front() {
+			myTrace.bare(TRACE_POP_FRONT);
+			myDeque.pop_front();
+		}
+
+		void pop_front(size_type n) {
+			myTrace.withArgument(TRACE_POP_FRONT_N, n);
+			myDeque.pop_front(n);
+		}
+
+		void prepend(const_pointer p, size_type n) {
+			myTrace.withArgument(TRACE_PREPEND, n);
+			myDeque.prepend(p, n);
+		}
+
+		template<typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type prepend(II b, II e) {
+			size_type before = myDeque.size();
+			myDeque.prepend(b, e);
+			myTrace.withArgument(TRACE_PREPEND, myDeque.size() - before);
+		}
+
+		void push_back(const_reference v) {
+			myTrace.bare(TRACE_PUSH_BACK);
+			myDeque.push_back(v);
+		}
+
+		void push_back(value_type&& v) {
+			myTrace.bare(TRACE_PUSH_BACK);
+			myDeque.push_back(std::move(v));
+		}
+
+		void push_front(const_reference v) {
+			myTrace.bare(TRACE_PUSH_FRONT);
+			myDeque.push_front(v);
+		}
+
+		void push_front(value_type&& v) {
+			myTrace.bare(TRACE_PUSH_FRONT);
+			myDeque.push_front(std::move(v));
+		}
+
+		void resize(size_type s, const_reference v = value_type()) {
+			myTrace.withArgument(TRACE_RESIZE, s);
+			myDeque.resize(s, v);
+		}
+
+		size_type size() const {
+			return myDeque.size();
+		}
+};
+
+/**
+ * The values replay makes from the running counter, one per count,
+ * as a forward range so range operations replay in one call
+ */
+template<typename T>
+class DequeTraceValues {
+	private:
+		std::size_t myCount;
+
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef T reference;
+
+		explicit DequeTraceValues(std::size_t count) : myCount(count) {}
+
+		T operator *() const {
+			return T(myCount);
+		}
+
+		DequeTraceValues& operator ++() {
+			++myCount;
+			return *this;
+		}
+
+		DequeTraceValues operator ++(int) {
+			DequeTraceValues x = *this;
+			++myCount;
+			return x;
+		}
+
+		friend bool operator ==(const DequeTraceValues& lhs, const DequeTraceValues& rhs) {
+			return lhs.myCount == rhs.myCount;
+		}
+
+		friend bool operator !=(const DequeTraceValues& lhs, const DequeTraceValues& rhs) {
+			return !(lhs == rhs);
+		}
+};
+
+/**
+ * An output iterator that adds up whatever is written through it,
+ * so replay reads drained elements without keeping them
+ */
+class DequeTraceChecksum {
+	private:
+		std::size_t* mySum;
+
+	public:
+		typedef std::output_iterator_tag iterator_category;
+		typedef void value_type;
+		typedef void difference_type;
+		typedef void pointer;
+		typedef void reference;
+
+		explicit DequeTraceChecksum(std::size_t& sum) : mySum(&sum) {}
+
+		DequeTraceChecksum& operator *() {
+			return *this;
+		}
+
+		DequeTraceChecksum& operator ++() {
+			return *this;
+		}
+
+		DequeTraceChecksum& operator ++(int) {
+			return *this;
+		}
+
+		template<typename T>
+		DequeTraceChecksum& operator =(const T& v) {
+			*mySum += static_cast<std::size_t>(v);
+			return *this;
+		}
+};
+
+/**
+ * Add [b, e) to the back in one call, the way the trace recorded it
+ * std::deque has no append, so other containers insert the range
+ */
+template<typename C, typename FI>
+void replay_append(C& c, FI b, FI e) {
+	c.insert(c.end(), b, e);
+}
+
+template<typename T, typename A, bool SmallBuffer, typename FI>
+void replay_append(MyDeque<T, A, SmallBuffer>& c, FI b, FI e) {
+	c.append(b, e);
+}
+
+/**
+ * Add [b, e) to the front in one call, keeping its order
+ */
+template<typename C, typename FI>
+void replay_prepend(C& c, FI b, FI e) {
+	c.insert(c.begin(), b, e);
+}
+
+template<typename T, typename A, bool SmallBuffer, typename FI>
+void replay_prepend(MyDeque<T, A, SmallBuffer>& c, FI b, FI e) {
+	c.prepend(b, e);
+}
+
+/**
+ * Read and remove the first n elements in one call
+ * Returns the checksum of what was removed
+ */
+template<typename C>
+std::size_t replay_drain_front(C& c, std::size_t n) {
+	std::size_t checksum = 0;
+	typename C::iterator e = c.begin() + static_cast<typename C::difference_type>(n);
+	std::move(c.begin(), e, DequeTraceChecksum(checksum));
+	c.erase(c.begin(), e);
+	return checksum;
+}
+
+template<typename T, typename A, bool SmallBuffer>
+std::size_t replay_drain_front(MyDeque<T, A, SmallBuffer>& c, std::size_t n) {
+	std::size_t checksum = 0;
+	c.drain_front(n, DequeTraceChecksum(checksum));
+	return checksum;
+}
+
+/**
+ * Remove the last n elements in one call, the way the trace recorded it
+ * std::deque has no pop_back(n), so other containers erase the range
+ */
+template<typename C>
+void replay_pop_back(C& c, std::size_t n) {
+	c.erase(c.end() - static_cast<typename C::difference_type>(n), c.end());
+}
+
+template<typename T, typename A, bool SmallBuffer>
+void replay_pop_back(MyDeque<T, A, SmallBuffer>& c, std::size_t n) {
+	c.pop_back(n);
+}
+
+/**
+ * Remove the first n elements in one call, the way the trace recorded it
+ */
+template<typename C>
+void replay_pop_front(C& c, std::size_t n) {
+	c.erase(c.begin(), c.begin() + static_cast<typename C::difference_type>(n));
+}
+
+template<typename T, typename A, bool SmallBuffer>
+void replay_pop_front(MyDeque<T, A, SmallBuffer>& c, std::size_t n) {
+	c.pop_front(n);
+}
+
+/**
+ * Run one record against c, whose elements are made from a running counter
+ * Returns a checksum of whatever was read
+ */
+template<typename C>
+std::size_t replay_record(C& c, const DequeTraceRecord& r, std::size_t& counter) {
+	typedef typename C::value_type value_type;
+	std::size_t checksum = 0;
+	switch (r.op) {
+		case TRACE_PUSH_BACK:
+			for (std::size_t i = 0; i < r.count; ++i)
+				c.push_back(value_type(counter++));
+			break;
+		case TRACE_PUSH_FRONT:
+			for (std::size_t i = 0; i < r.count; ++i)
+				c.push_front(value_type(counter++));
+			break;
+		case TRACE_POP_BACK:
+			for (std::size_t i = 0; i < r.count; ++i)
+				c.pop_back();
+			break;
+		case TRACE_POP_FRONT:
+			for (std::size_t i = 0; i < r.count; ++i)
+				c.pop_front();
+			break;
+		case TRACE_POP_BACK_N:
+			replay_pop_back(c, r.argument);
+			break;
+		case TRACE_POP_FRONT_N:
+			replay_pop_front(c, r.argument);
+			break;
+		case TRACE_CLEAR:
+			c.clear();
+			break;
+		case TRACE_RESIZE:
+			c.resize(r.argument, value_type(counter++));
+			break;
+		case TRACE_INDEX:
+			checksum = static_cast<std::size_t>(c[r.argument]);
+			break;
+		case TRACE_INSERT:
+			c.insert(c.begin() + static_cast<typename C::difference_type>(r.argument), value_type(counter++));
+			break;
+		case TRACE_ERASE:
+			c.erase(c.begin() + static_cast<typename C::difference_type>(r.argument));
+			break;
+		case TRACE_APPEND:
+			replay_append(c, DequeTraceValues<value_type>(counter), DequeTraceValues<value_type>(counter + r.argument));
+			counter += r.argument;
+			break;
+		case TRACE_PREPEND:
+			replay_prepend(c, DequeTraceValues<value_type>(counter), DequeTraceValues<value_type>(counter + r.argument));
+			counter += r.argument;
+			break;
+		case TRACE_ASSIGN:
+			c.assign(DequeTraceValues<value_type>(counter), DequeTraceValues<value_type>(counter + r.argument));
+			counter += r.argument;
+			break;
+		case TRACE_DRAIN_FRONT:
+			checksum = replay_drain_front(c, r.argument);
+			break;
+		default:
+			break;
+	}
+	return checksum;
+}
+
+#endif // DequeTrace_h
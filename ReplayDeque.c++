@@ -0,0 +1,274 @@
+/*
+ * ReplayDeque
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++0x -Wall ReplayDeque.c++ -O2 -DNDEBUG -o ReplayDeque
+ *
+ * Then it can run with
+ * ReplayDeque trace             - replay a trace recorded with RecordingDeque
+ * ReplayDeque --record trace    - record the built-in sample workload to a file
+ * ReplayDeque                   - record the sample workload in memory and replay it
+ *
+ * Each trace runs against MyDeque and std::deque, with every phase reported
+ * on its own: time, allocations, and the peak bytes held by the container
+ */
+
+#include <chrono>    // steady_clock
+#include <cstdio>    // printf
+#include <cstring>   // memcpy, strcmp
+#include <deque>     // deque
+#include <exception> // exception
+#include <fstream>   // ifstream, ofstream
+#include <iostream>  // cerr
+#include <sstream>   // stringstream
+#include <string>    // string
+#include <vector>    // vector
+
+#include "DequeTestSupport.h"
+#include "DequeTrace.h"
+
+// --- instrumentation ---
+
+/**
+ * What every TrackingAllocator has handed out
+ */
+struct AllocationStats {
+	static unsigned long allocations;
+	static std::size_t live;
+	static std::size_t peak;
+};
+
+unsigned long AllocationStats::allocations = 0;
+std::size_t AllocationStats::live = 0;
+std::size_t AllocationStats::peak = 0;
+
+template<typename T>
+struct TrackingAllocator {
+	typedef T value_type;
+
+	TrackingAllocator() {}
+
+	template<typename U>
+	TrackingAllocator(const TrackingAllocator<U>&) {}
+
+	T* allocate(std::size_t n) {
+		++AllocationStats::allocations;
+		AllocationStats::live += n * sizeof(T);
+		if (AllocationStats::live > AllocationStats::peak)
+			AllocationStats::peak = AllocationStats::live;
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T* p, std::size_t n) {
+		AllocationStats::live -= n * sizeof(T);
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	friend bool operator ==(const TrackingAllocator&, const TrackingAllocator&) {
+		return true;
+	}
+
+	friend bool operator !=(const TrackingAllocator&, const TrackingAllocator&) {
+		return false;
+	}
+};
+
+/**
+ * Stands in for the recorded element type, at the recorded size
+ */
+template<std::size_t N>
+struct Payload {
+	unsigned char bytes[N];
+
+	Payload(std::size_t v = 0) {
+		std::memset(bytes, 0, N);
+		std::memcpy(bytes, &v, N < sizeof(v) ? N : sizeof(v));
+	}
+
+	operator std::size_t() const {
+		std::size_t v = 0;
+		std::memcpy(&v, bytes, N < sizeof(v) ? N : sizeof(v));
+		return v;
+	}
+};
+
+// --- replay ---
+
+/**
+ * The records between one phase marker and the next
+ */
+struct Phase {
+	std::string name;
+	std::vector<DequeTraceRecord> records;
+};
+
+struct PhaseResult {
+	double seconds;
+	unsigned long allocations;
+	std::size_t peak;
+};
+
+/**
+ * Run every phase against a fresh C, returning a checksum of everything read
+ */
+template<typename C>
+std::size_t replay(const std::vector<Phase>& phases, std::vector<PhaseResult>& results) {
+	C c;
+	std::size_t counter = 0;
+	std::size_t checksum = 0;
+	results.clear();
+
+	for (std::size_t p = 0; p < phases.size(); ++p) {
+		const std::vector<DequeTraceRecord>& records = phases[p].records;
+		unsigned long allocations = AllocationStats::allocations;
+		AllocationStats::peak = AllocationStats::live;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (std::size_t r = 0; r < records.size(); ++r)
+			checksum += replay_record(c, records[r], counter);
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		PhaseResult result = {elapsed.count(), AllocationStats::allocations - allocations, AllocationStats::peak};
+		results.push_back(result);
+	}
+	return checksum + c.size();
+}
+
+template<std::size_t N>
+int replayAll(const std::vector<Phase>& phases) {
+	typedef Payload<N> T;
+	std::vector<PhaseResult> mine;
+	std::vector<PhaseResult> theirs;
+	std::size_t mySum = replay<MyDeque<T, TrackingAllocator<T> > >(phases, mine);
+	std::size_t theirSum = replay<std::deque<T, TrackingAllocator<T> > >(phases, theirs);
+
+	std::printf("%-16s %-11s %10s %10s %12s\n", "phase", "container", "ms", "allocs", "peak KiB");
+	for (std::size_t p = 0; p < phases.size(); ++p) {
+		const char* name = phases[p].name.c_str();
+		std::printf("%-16s %-11s %10.2f %10lu %12.1f\n", name, "MyDeque",
+				mine[p].seconds * 1e3, mine[p].allocations, mine[p].peak / 1024.0);
+		std::printf("%-16s %-11s %10.2f %10lu %12.1f\n", "", "std::deque",
+				theirs[p].seconds * 1e3, theirs[p].allocations, theirs[p].peak / 1024.0);
+	}
+
+	if (mySum != theirSum) {
+		std::printf("MISMATCH: MyDeque read %lu, std::deque read %lu\n",
+				(unsigned long) mySum, (unsigned long) theirSum);
+		return 1;
+	}
+	std::printf("both containers read the same values\n");
+	return 0;
+}
+
+/**
+ * Split a trace into phases, so parsing stays out of the timings
+ * Anything before the first marker goes in an unnamed phase
+ */
+std::vector<Phase> readPhases(DequeTraceReader& reader) {
+	std::vector<Phase> phases(1);
+	phases[0].name = "(start)";
+	DequeTraceRecord r;
+	while (reader.next(r)) {
+		if (r.op == TRACE_PHASE) {
+			if (!phases.back().records.empty() || phases.size() > 1)
+				phases.push_back(Phase());
+			phases.back().name = r.phase;
+		}
+		else
+			phases.back().records.push_back(r);
+	}
+	return phases;
+}
+
+// --- sample workload ---
+
+/**
+ * A little of everything, to show what a trace looks like
+ */
+void recordSample(DequeTraceWriter& trace) {
+	RecordingDeque<long> x(trace);
+	Samples samples(1);
+
+	x.phase("fill");
+	for (long i = 0; i < 2000000; ++i)
+		x.push_back(i);
+
+	x.phase("random index");
+	for (long i = 0; i < 1000000; ++i) {
+		sink() = x[samples.next(x.size())];
+	}
+
+	x.phase("queue");
+	for (long i = 0; i < 4000000; ++i) {
+		x.push_back(i);
+		x.pop_front();
+	}
+
+	x.phase("both ends");
+	for (long i = 0; i < 1000000; ++i) {
+		x.push_front(i);
+		x.push_front(i);
+		x.pop_back();
+	}
+
+	x.phase("drain");
+	while (x.size() > 1000)
+		x.pop_front(1000);
+	x.clear();
+
+	x.phase("middle edits");
+	for (long i = 0; i < 20000; ++i)
+		x.push_back(i);
+	for (long i = 0; i < 2000; ++i) {
+		unsigned long state = samples.bits();
+		x.insert(x.begin() + (state >> 33) % x.size(), i);
+		x.erase(x.begin() + (state >> 35) % x.size());
+	}
+	trace.flush();
+}
+
+int main(int argc, char** argv) {
+	try {
+		if (argc == 3 && std::strcmp(argv[1], "--record") == 0) {
+			std::ofstream out(argv[2], std::ios::binary);
+			DequeTraceWriter trace(out, sizeof(long));
+			recordSample(trace);
+			return 0;
+		}
+
+		std::stringstream buffer;
+		if (argc == 2) {
+			std::ifstream in(argv[1], std::ios::binary);
+			if (!in) {
+				std::cerr << "can't open " << argv[1] << std::endl;
+				return 1;
+			}
+			buffer << in.rdbuf();
+		}
+		else {
+			DequeTraceWriter trace(buffer, sizeof(long));
+			recordSample(trace);
+		}
+		std::printf("trace of %lu bytes\n", (unsigned long) buffer.str().size());
+
+		DequeTraceReader reader(buffer);
+		std::vector<Phase> phases = readPhases(reader);
+		std::size_t size = reader.elementSize();
+		std::printf("elements of %lu bytes\n", (unsigned long) size);
+		if (size <= 4)
+			return replayAll<4>(phases);
+		if (size <= 8)
+			return replayAll<8>(phases);
+		if (size <= 16)
+			return replayAll<16>(phases);
+		if (size <= 32)
+			return replayAll<32>(phases);
+		if (size <= 64)
+			return replayAll<64>(phases);
+		return replayAll<128>(phases);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "ReplayDeque: " << e.what() << std::endl;
+		return 1;
+	}
+}
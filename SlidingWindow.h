@@ -0,0 +1,328 @@
+// ------------------------------
+// projects/deque/SlidingWindow.h
+// ------------------------------
+
+#ifndef SlidingWindow_h
+#define SlidingWindow_h
+
+#include <cstddef>    // size_t
+#include <functional> // greater, less, plus
+#include <limits>     // numeric_limits
+#include <memory>     // allocator, allocator_traits
+#include <utility>    // pair
+
+#include "Deque.h"
+
+/**
+ * Folds an associative operator over a first in, first out window
+ * in amortized O(1) per sample, using two stacks
+ * Samples pushed since the last flip are folded into one running value,
+ * and the older ones keep suffix aggregates so the oldest can be dropped
+ * without recomputing anything
+ * Op needs neither an inverse nor to be commutative
+ */
+template<typename T, typename Op = std::plus<T>, typename A = std::allocator<T> >
+class WindowAggregate {
+	public:
+		typedef typename MyDeque<T, A>::size_type size_type;
+
+	private:
+		// myFront[i] is the aggregate of older sample i through the newest older sample
+		MyDeque<T, A> myFront;
+
+		// The samples pushed since the last flip, oldest first
+		MyDeque<T, A> myBack;
+
+		// The aggregate of myBack, only meaningful when myBack isn't empty
+		T myBackAggregate;
+
+		Op myOp;
+
+	private:
+		/**
+		 * Move every sample in myBack over to myFront,
+		 * computing the suffix aggregates newest first
+		 */
+		void flip() {
+			for (size_type i = myBack.size(); i > 0; --i) {
+				if (myFront.empty())
+					myFront.push_front(myBack[i - 1]);
+				else
+					myFront.push_front(myOp(myBack[i - 1], myFront.front()));
+			}
+			myBack.clear();
+		}
+
+	public:
+		/**
+		 * Create an empty window
+		 */
+		explicit WindowAggregate(const Op& op = Op(), const A& a = A()) :
+				myFront(a),
+				myBack(a),
+				myBackAggregate(),
+				myOp(op) {}
+
+		/**
+		 * Add the newest sample to the window
+		 */
+		void push_back(const T& v) {
+			myBackAggregate = myBack.empty() ? v : myOp(myBackAggregate, v);
+			myBack.push_back(v);
+		}
+
+		/**
+		 * Drop the oldest sample from the window
+		 */
+		void pop_front() {
+			MYDEQUE_CHECK(!empty());
+			if (myFront.empty())
+				flip();
+			myFront.pop_front();
+		}
+
+		/**
+		 * Returns the aggregate of every sample in the window, oldest first
+		 */
+		T aggregate() const {
+			MYDEQUE_CHECK(!empty());
+			if (myFront.empty())
+				return myBackAggregate;
+			if (myBack.empty())
+				return myFront.front();
+			return myOp(myFront.front(), myBackAggregate);
+		}
+
+		/**
+		 * Drop every sample from the window
+		 */
+		void clear() {
+			myFront.clear();
+			myBack.clear();
+		}
+
+		/**
+		 * Returns true if the window holds no samples
+		 */
+		bool empty() const {
+			return myFront.empty() && myBack.empty();
+		}
+
+		/**
+		 * Returns the number of samples in the window
+		 */
+		size_type size() const {
+			return myFront.size() + myBack.size();
+		}
+};
+
+/**
+ * Tracks the extreme of a first in, first out window under Compare
+ * in amortized O(1) per sample
+ * Only samples that could still become the extreme are kept: each one
+ * beats everything pushed after it, so the front is always the answer
+ * std::less tracks the minimum, std::greater the maximum
+ */
+template<typename T, typename Compare = std::less<T>, typename A = std::allocator<T> >
+class MonotonicWindow {
+	public:
+		typedef unsigned long long size_type;
+
+	private:
+		// Each candidate remembers its position in the stream,
+		// so pop_front can tell whether it is the one leaving
+		typedef std::pair<size_type, T> candidate;
+		typedef typename std::allocator_traits<A>::template rebind_alloc<candidate> candidate_allocator_type;
+
+		MyDeque<candidate, candidate_allocator_type> myCandidates;
+		size_type myPushed;
+		size_type myPopped;
+		Compare myCompare;
+
+	public:
+		/**
+		 * Create an empty window
+		 */
+		explicit MonotonicWindow(const Compare& c = Compare(), const A& a = A()) :
+				myCandidates(candidate_allocator_type(a)),
+				myPushed(0),
+				myPopped(0),
+				myCompare(c) {}
+
+		/**
+		 * Add the newest sample to the window
+		 * Every candidate it beats or ties can never be the extreme again
+		 */
+		void push_back(const T& v) {
+			while (!myCandidates.empty() && !myCompare(myCandidates.back().second, v))
+				myCandidates.pop_back();
+			myCandidates.push_back(candidate(myPushed, v));
+			++myPushed;
+		}
+
+		/**
+		 * Drop the oldest sample from the window
+		 */
+		void pop_front() {
+			MYDEQUE_CHECK(!empty());
+			if (myCandidates.front().first == myPopped)
+				myCandidates.pop_front();
+			++myPopped;
+		}
+
+		/**
+		 * Returns the extreme of every sample in the window
+		 */
+		const T& extreme() const {
+			MYDEQUE_CHECK(!empty());
+			return myCandidates.front().second;
+		}
+
+		/**
+		 * Drop every sample from the window
+		 */
+		void clear() {
+			myCandidates.clear();
+			myPopped = myPushed;
+		}
+
+		/**
+		 * Returns true if the window holds no samples
+		 */
+		bool empty() const {
+			return myPushed == myPopped;
+		}
+
+		/**
+		 * Returns the number of samples in the window
+		 */
+		size_type size() const {
+			return myPushed - myPopped;
+		}
+};
+
+/**
+ * Rolling count, sum, minimum and maximum over a stream of timestamped samples,
+ * all amortized O(1) per sample
+ * A sample leaves the window once maxCount newer samples have arrived, or once
+ * it is maxAge older than the newest time seen, whichever happens first
+ * Timestamps must never go backwards
+ */
+template<typename T, typename Time = long long, typename A = std::allocator<T> >
+class RollingStats {
+	public:
+		typedef typename std::allocator_traits<A>::template rebind_alloc<Time> time_allocator_type;
+		typedef typename MyDeque<Time, time_allocator_type>::size_type size_type;
+
+	private:
+		size_type myMaxCount;
+		Time myMaxAge;
+
+		MyDeque<Time, time_allocator_type> myTimes;
+		WindowAggregate<T, std::plus<T>, A> mySum;
+		MonotonicWindow<T, std::less<T>, A> myMin;
+		MonotonicWindow<T, std::greater<T>, A> myMax;
+
+	private:
+		/**
+		 * Drop the oldest sample from every aggregate
+		 */
+		void evict() {
+			myTimes.pop_front();
+			mySum.pop_front();
+			myMin.pop_front();
+			myMax.pop_front();
+		}
+
+	public:
+		/**
+		 * Create an empty window holding at most maxCount samples,
+		 * none of them maxAge or more older than the newest time
+		 */
+		explicit RollingStats(size_type maxCount,
+				Time maxAge = std::numeric_limits<Time>::max(),
+				const A& a = A()) :
+				myMaxCount(maxCount),
+				myMaxAge(maxAge),
+				myTimes(time_allocator_type(a)),
+				mySum(std::plus<T>(), a),
+				myMin(std::less<T>(), a),
+				myMax(std::greater<T>(), a) {}
+
+		/**
+		 * Add a sample taken at time t, evicting whatever it pushes out
+		 */
+		void push(Time t, const T& v) {
+			MYDEQUE_CHECK(myTimes.empty() || !(t < myTimes.back()));
+			myTimes.push_back(t);
+			mySum.push_back(v);
+			myMin.push_back(v);
+			myMax.push_back(v);
+			advance(t);
+		}
+
+		/**
+		 * Evict the samples that have aged out by time t,
+		 * or that no longer fit in the count
+		 */
+		void advance(Time t) {
+			while (myTimes.size() > myMaxCount)
+				evict();
+			while (!myTimes.empty() && !(t - myTimes.front() < myMaxAge))
+				evict();
+		}
+
+		/**
+		 * Drop every sample from the window
+		 */
+		void clear() {
+			myTimes.clear();
+			mySum.clear();
+			myMin.clear();
+			myMax.clear();
+		}
+
+		/**
+		 * Returns true if the window holds no samples
+		 */
+		bool empty() const {
+			return myTimes.empty();
+		}
+
+		/**
+		 * Returns the number of samples in the window
+		 */
+		size_type size() const {
+			return myTimes.size();
+		}
+
+		/**
+		 * Returns the sum of the samples in the window
+		 */
+		T sum() const {
+			return mySum.aggregate();
+		}
+
+		/**
+		 * Returns the smallest sample in the window
+		 */
+		const T& min() const {
+			return myMin.extreme();
+		}
+
+		/**
+		 * Returns the largest sample in the window
+		 */
+		const T& max() const {
+			return myMax.extreme();
+		}
+
+		/**
+		 * Returns the time of the oldest sample in the window
+		 */
+		const Time& oldest() const {
+			return myTimes.front();
+		}
+};
+
+#endif // SlidingWindow_h
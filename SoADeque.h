@@ -0,0 +1,1129 @@
+// --------------------------
+// projects/deque/SoADeque.h
+// --------------------------
+
+#ifndef SoADeque_h
+#define SoADeque_h
+
+#include <algorithm>   // min, swap
+#include <cstddef>     // ptrdiff_t, size_t
+#include <cstring>     // memcpy
+#include <iterator>    // bidirectional_iterator_tag
+#include <memory>      // allocator, allocator_traits
+#include <stdexcept>   // out_of_range
+#include <tuple>       // get, tuple, tuple_element
+#include <type_traits> // aligned_storage, false_type, is_trivially_copyable, true_type
+
+#include "Deque.h"
+
+/**
+ * The indices 0 through N - 1 as a type,
+ * so a tuple can be walked one field per pack element
+ */
+template<std::size_t... I>
+struct SoAIndices {};
+
+template<std::size_t N, std::size_t... I>
+struct SoAMakeIndices : SoAMakeIndices<N - 1, N - 1, I...> {};
+
+template<std::size_t... I>
+struct SoAMakeIndices<0, I...> {
+	typedef SoAIndices<I...> type;
+};
+
+/**
+ * The bytes one element of the first K fields takes up,
+ * which times the row size is where column K starts in a row
+ */
+template<std::size_t K, typename... Fields>
+struct SoAColumnBytes;
+
+template<>
+struct SoAColumnBytes<0> {
+	static const std::size_t value = 0;
+};
+
+template<typename F, typename... Fields>
+struct SoAColumnBytes<0, F, Fields...> {
+	static const std::size_t value = 0;
+};
+
+template<std::size_t K, typename F, typename... Fields>
+struct SoAColumnBytes<K, F, Fields...> {
+	static const std::size_t value = sizeof(F) + SoAColumnBytes<K - 1, Fields...>::value;
+};
+
+/**
+ * The strictest alignment among the fields,
+ * and whether every one of them can be copied with memcpy
+ */
+template<typename... Fields>
+struct SoAFieldTraits;
+
+template<>
+struct SoAFieldTraits<> {
+	static const std::size_t alignment = 1;
+	static const bool trivial = true;
+};
+
+template<typename F, typename... Fields>
+struct SoAFieldTraits<F, Fields...> {
+	static const std::size_t alignment = alignof(F) > SoAFieldTraits<Fields...>::alignment ?
+			alignof(F) : SoAFieldTraits<Fields...>::alignment;
+	static const bool trivial = std::is_trivially_copyable<F>::value && SoAFieldTraits<Fields...>::trivial;
+};
+
+/**
+ * A contiguous run of one column, as handed out by SoADeque::column
+ * Loops over data() through data() + size() touch only that column
+ */
+template<typename T>
+class SoASpan {
+	private:
+		T* myData;
+		std::size_t mySize;
+
+	public:
+		SoASpan(T* data, std::size_t size) : myData(data), mySize(size) {}
+
+		T* data() const {
+			return myData;
+		}
+
+		std::size_t size() const {
+			return mySize;
+		}
+
+		T* begin() const {
+			return myData;
+		}
+
+		T* end() const {
+			return myData + mySize;
+		}
+
+		T& operator [](std::size_t index) const {
+			return myData[index];
+		}
+};
+
+template<typename Fields, typename A = std::allocator<Fields> >
+class SoADeque;
+
+/**
+ * A deque of tuples stored as a structure of arrays
+ * Each row holds ROW_SIZE elements as one column per field, back to back,
+ * so scanning one field reads only that field's bytes
+ * Elements are reached through proxy references, and column<K>() hands out
+ * field K as one contiguous span per row
+ * Rows and the map are managed by MyDequeMap, the same as in MyDeque
+ * Every field must be trivially copyable, so elements are never constructed
+ * or destroyed, only copied in and out
+ */
+template<typename... Fields, typename A>
+class SoADeque<std::tuple<Fields...>, A> : private MyDequeMap<SoADeque<std::tuple<Fields...>, A>, std::size_t> {
+	public:
+		typedef A allocator_type;
+		typedef std::tuple<Fields...> value_type;
+
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+
+		/**
+		 * The type of field K
+		 */
+		template<std::size_t K>
+		struct field {
+			typedef typename std::tuple_element<K, value_type>::type type;
+		};
+
+		static_assert(sizeof...(Fields) > 0, "SoADeque needs at least one field");
+		static_assert(SoAFieldTraits<Fields...>::trivial, "SoADeque fields must be trivially copyable");
+
+	private:
+		const static unsigned int LOG_ROW_SIZE = 7;
+		const static size_type ROW_SIZE = 1 << LOG_ROW_SIZE;
+
+		// One row is every column for ROW_SIZE elements, aligned for the strictest field
+		// Each column starts at ROW_SIZE times the bytes of the fields before it,
+		// which keeps it aligned for its own field
+		typedef typename std::aligned_storage<ROW_SIZE * SoAColumnBytes<sizeof...(Fields), Fields...>::value,
+				SoAFieldTraits<Fields...>::alignment>::type row_type;
+		typedef row_type* row_pointer;
+
+		typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<row_type> row_allocator_type;
+		typedef std::allocator_traits<row_allocator_type> row_allocator_traits;
+		typedef typename std::allocator_traits<allocator_type>::template rebind_alloc<row_pointer> map_allocator_type;
+		typedef std::allocator_traits<map_allocator_type> map_allocator_traits;
+		typedef row_pointer* map_pointer;
+
+		typedef typename SoAMakeIndices<sizeof...(Fields)>::type indices;
+
+		typedef MyDequeMap<SoADeque, size_type> map_base;
+		friend class MyDequeMap<SoADeque, size_type>;
+
+		using map_base::initMap;
+		using map_base::destroyMap;
+		using map_base::reserveFront;
+		using map_base::reserveBack;
+		using map_base::clearRows;
+
+	private:
+		/**
+		 * Helper function to find column K of a row
+		 */
+		template<std::size_t K>
+		static typename field<K>::type* columnOf(row_pointer row) {
+			return reinterpret_cast<typename field<K>::type*>(
+					reinterpret_cast<unsigned char*>(row) + ROW_SIZE * SoAColumnBytes<K, Fields...>::value);
+		}
+
+		/**
+		 * Helper function to gather the element at an offset in a row
+		 */
+		template<std::size_t... I>
+		static value_type load(row_pointer row, size_type offset, SoAIndices<I...>) {
+			return value_type(columnOf<I>(row)[offset]...);
+		}
+
+		/**
+		 * Helper function to scatter v across the columns at an offset in a row
+		 */
+		template<std::size_t... I>
+		static void store(row_pointer row, size_type offset, const value_type& v, SoAIndices<I...>) {
+			int expand[] = {(columnOf<I>(row)[offset] = std::get<I>(v), 0)...};
+			(void) expand;
+		}
+
+	public:
+		/**
+		 * Stands in for an element, which is spread over the columns of its row
+		 * Assigning through it writes the element, it never rebinds
+		 */
+		class reference {
+			private:
+				friend class SoADeque;
+
+				row_pointer myRow;
+				size_type myOffset;
+
+				reference(row_pointer row, size_type offset) : myRow(row), myOffset(offset) {}
+
+			public:
+				/**
+				 * Returns field K of the element
+				 */
+				template<std::size_t K>
+				typename field<K>::type& get() const {
+					return columnOf<K>(myRow)[myOffset];
+				}
+
+				/**
+				 * Gathers every field of the element
+				 */
+				operator value_type() const {
+					return load(myRow, myOffset, indices());
+				}
+
+				/**
+				 * Scatters v over the element's fields
+				 */
+				reference& operator =(const value_type& v) {
+					store(myRow, myOffset, v, indices());
+					return *this;
+				}
+
+				/**
+				 * Copies the element that refers to into this one
+				 */
+				reference& operator =(const reference& that) {
+					return *this = static_cast<value_type>(that);
+				}
+
+				/**
+				 * Compares the element with v
+				 */
+				friend bool operator ==(const reference& lhs, const value_type& rhs) {
+					return static_cast<value_type>(lhs) == rhs;
+				}
+
+				/**
+				 * Exchanges the elements the references stand in for
+				 */
+				friend void swap(reference lhs, reference rhs) {
+					value_type x = lhs;
+					lhs = rhs;
+					rhs = x;
+				}
+		};
+
+		/**
+		 * Stands in for an element that can only be read
+		 */
+		class const_reference {
+			private:
+				friend class SoADeque;
+
+				row_pointer myRow;
+				size_type myOffset;
+
+				const_reference(row_pointer row, size_type offset) : myRow(row), myOffset(offset) {}
+
+			public:
+				const_reference(const reference& that) : myRow(that.myRow), myOffset(that.myOffset) {}
+
+				/**
+				 * Returns field K of the element
+				 */
+				template<std::size_t K>
+				const typename field<K>::type& get() const {
+					return columnOf<K>(myRow)[myOffset];
+				}
+
+				/**
+				 * Gathers every field of the element
+				 */
+				operator value_type() const {
+					return load(myRow, myOffset, indices());
+				}
+
+				/**
+				 * Compares the element with v
+				 */
+				friend bool operator ==(const const_reference& lhs, const value_type& rhs) {
+					return static_cast<value_type>(lhs) == rhs;
+				}
+		};
+
+	public:
+		class iterator {
+			public:
+				typedef std::bidirectional_iterator_tag iterator_category;
+				typedef typename SoADeque::value_type value_type;
+				typedef typename SoADeque::difference_type difference_type;
+				typedef void pointer;
+				typedef typename SoADeque::reference reference;
+
+				friend class SoADeque;
+
+				/**
+				 * Compares the iterators for equality
+				 */
+				friend bool operator ==(const iterator& lhs, const iterator& rhs) {
+					return lhs.currentRow == rhs.currentRow && lhs.currentOffset == rhs.currentOffset;
+				}
+
+				/**
+				 * Compares the iterators for inequality
+				 */
+				friend bool operator !=(const iterator& lhs, const iterator& rhs) {
+					return !(lhs == rhs);
+				}
+
+				/**
+				 * Returns true if lhs is before rhs
+				 */
+				friend bool operator <(const iterator& lhs, const iterator& rhs) {
+					return (lhs.currentRow == rhs.currentRow) ?
+							(lhs.currentOffset < rhs.currentOffset) :
+							(lhs.currentRow < rhs.currentRow);
+				}
+
+				/**
+				 * Move the iterator rhs steps forward
+				 */
+				friend iterator operator +(iterator lhs, difference_type rhs) {
+					return lhs += rhs;
+				}
+
+				/**
+				 * Move the iterator rhs steps back
+				 */
+				friend iterator operator -(iterator lhs, difference_type rhs) {
+					return lhs -= rhs;
+				}
+
+			private:
+				// The row, and the element's offset in each of the row's columns
+				map_pointer currentRow;
+				size_type currentOffset;
+
+			public:
+				/**
+				 * Creates an empty iterator
+				 * Does NOT create a valid iterator
+				 */
+				iterator() : currentRow(NULL), currentOffset(0) {}
+
+				/**
+				 * Creates a new iterator from a row and an offset in it
+				 */
+				iterator(map_pointer row, size_type offset) : currentRow(row), currentOffset(offset) {}
+
+				/**
+				 * Return a proxy for the element this iterator points to
+				 */
+				reference operator *() const {
+					return reference(*currentRow, currentOffset);
+				}
+
+				/**
+				 * Move this iterator forward by 1
+				 */
+				iterator& operator ++() {
+					if (++currentOffset == ROW_SIZE) {
+						++currentRow;
+						currentOffset = 0;
+					}
+					return *this;
+				}
+
+				/**
+				 * Move this iterator forward by 1,
+				 * returns the old value
+				 */
+				iterator operator ++(int) {
+					iterator x = *this;
+					++(*this);
+					return x;
+				}
+
+				/**
+				 * Move this iterator back by 1
+				 */
+				iterator& operator --() {
+					if (currentOffset == 0) {
+						--currentRow;
+						currentOffset = ROW_SIZE;
+					}
+					--currentOffset;
+					return *this;
+				}
+
+				/**
+				 * Move this iterator back by 1,
+				 * returns the old value
+				 */
+				iterator operator --(int) {
+					iterator x = *this;
+					--(*this);
+					return x;
+				}
+
+				/**
+				 * Move the iterator forward by d steps
+				 */
+				iterator& operator +=(difference_type d) {
+					difference_type newPosition = d + static_cast<difference_type>(currentOffset);
+					difference_type newRow = newPosition >= 0 ?
+							newPosition / static_cast<difference_type>(ROW_SIZE) :
+							-((-newPosition - 1) / static_cast<difference_type>(ROW_SIZE)) - 1;
+					currentRow += newRow;
+					currentOffset = newPosition - newRow * static_cast<difference_type>(ROW_SIZE);
+					return *this;
+				}
+
+				/**
+				 * Move the iterator back by d steps
+				 */
+				iterator& operator -=(difference_type d) {
+					return *this += -d;
+				}
+		};
+
+		class const_iterator {
+			public:
+				typedef std::bidirectional_iterator_tag iterator_category;
+				typedef typename SoADeque::value_type value_type;
+				typedef typename SoADeque::difference_type difference_type;
+				typedef void pointer;
+				typedef typename SoADeque::const_reference reference;
+
+				friend class SoADeque;
+
+				/**
+				 * Compares the iterators for equality
+				 */
+				friend bool operator ==(const const_iterator& lhs, const const_iterator& rhs) {
+					return lhs.currentRow == rhs.currentRow && lhs.currentOffset == rhs.currentOffset;
+				}
+
+				/**
+				 * Compares the iterators for inequality
+				 */
+				friend bool operator !=(const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs == rhs);
+				}
+
+				/**
+				 * Returns true if lhs is before rhs
+				 */
+				friend bool operator <(const const_iterator& lhs, const const_iterator& rhs) {
+					return (lhs.currentRow == rhs.currentRow) ?
+							(lhs.currentOffset < rhs.currentOffset) :
+							(lhs.currentRow < rhs.currentRow);
+				}
+
+				/**
+				 * Move the iterator rhs steps forward
+				 */
+				friend const_iterator operator +(const_iterator lhs, difference_type rhs) {
+					return lhs += rhs;
+				}
+
+				/**
+				 * Move the iterator rhs steps back
+				 */
+				friend const_iterator operator -(const_iterator lhs, difference_type rhs) {
+					return lhs -= rhs;
+				}
+
+			private:
+				// The same two words as iterator, with the constness kept at the interface
+				iterator myIterator;
+
+			public:
+				/**
+				 * Creates an empty iterator
+				 * Does NOT create a valid iterator
+				 */
+				const_iterator() : myIterator() {}
+
+				/**
+				 * Creates a new const_iterator from a row and an offset in it
+				 */
+				const_iterator(map_pointer row, size_type offset) : myIterator(row, offset) {}
+
+				/**
+				 * Converts an iterator to a const_iterator
+				 */
+				const_iterator(const iterator& that) : myIterator(that) {}
+
+				/**
+				 * Return a proxy for the element this iterator points to
+				 */
+				reference operator *() const {
+					return *myIterator;
+				}
+
+				/**
+				 * Move this iterator forward by 1
+				 */
+				const_iterator& operator ++() {
+					++myIterator;
+					return *this;
+				}
+
+				/**
+				 * Move this iterator forward by 1,
+				 * returns the old value
+				 */
+				const_iterator operator ++(int) {
+					const_iterator x = *this;
+					++myIterator;
+					return x;
+				}
+
+				/**
+				 * Move this iterator back by 1
+				 */
+				const_iterator& operator --() {
+					--myIterator;
+					return *this;
+				}
+
+				/**
+				 * Move this iterator back by 1,
+				 * returns the old value
+				 */
+				const_iterator operator --(int) {
+					const_iterator x = *this;
+					--myIterator;
+					return x;
+				}
+
+				/**
+				 * Move the iterator forward by d steps
+				 */
+				const_iterator& operator +=(difference_type d) {
+					myIterator += d;
+					return *this;
+				}
+
+				/**
+				 * Move the iterator back by d steps
+				 */
+				const_iterator& operator -=(difference_type d) {
+					myIterator -= d;
+					return *this;
+				}
+		};
+
+		/**
+		 * One field of every element, as one contiguous span per row
+		 * T is the field's type, const when the column is read only
+		 * Iterating gives the spans front to back, so a scan or reduction
+		 * over the column is a loop over plain arrays
+		 */
+		template<typename T, std::size_t K>
+		class column_view {
+			public:
+				typedef SoASpan<T> segment;
+
+				class segment_iterator {
+					public:
+						typedef std::forward_iterator_tag iterator_category;
+						typedef segment value_type;
+						typedef typename SoADeque::difference_type difference_type;
+						typedef void pointer;
+						typedef segment reference;
+
+						friend class column_view;
+
+						/**
+						 * Compares the iterators for equality
+						 */
+						friend bool operator ==(const segment_iterator& lhs, const segment_iterator& rhs) {
+							return lhs.myRemaining == rhs.myRemaining;
+						}
+
+						/**
+						 * Compares the iterators for inequality
+						 */
+						friend bool operator !=(const segment_iterator& lhs, const segment_iterator& rhs) {
+							return !(lhs == rhs);
+						}
+
+					private:
+						map_pointer myRow;
+						size_type myFirst;
+						size_type myRemaining;
+
+						segment_iterator(map_pointer row, size_type first, size_type remaining) :
+								myRow(row),
+								myFirst(first),
+								myRemaining(remaining) {}
+
+					public:
+						/**
+						 * Returns the part of the column in the current row
+						 */
+						segment operator *() const {
+							return segment(columnOf<K>(*myRow) + myFirst,
+									std::min<size_type>(myRemaining, ROW_SIZE - myFirst));
+						}
+
+						/**
+						 * Move on to the next row
+						 */
+						segment_iterator& operator ++() {
+							myRemaining -= std::min<size_type>(myRemaining, ROW_SIZE - myFirst);
+							myFirst = 0;
+							++myRow;
+							return *this;
+						}
+
+						/**
+						 * Move on to the next row,
+						 * returns the old value
+						 */
+						segment_iterator operator ++(int) {
+							segment_iterator x = *this;
+							++(*this);
+							return x;
+						}
+				};
+
+				friend class SoADeque;
+
+			private:
+				map_pointer myRow;
+				size_type myFirst;
+				size_type mySize;
+
+				column_view(map_pointer row, size_type first, size_type size) :
+						myRow(row),
+						myFirst(first),
+						mySize(size) {}
+
+			public:
+				/**
+				 * Returns the span in the first row
+				 */
+				segment_iterator begin() const {
+					return segment_iterator(myRow, myFirst, mySize);
+				}
+
+				/**
+				 * Returns the iterator past the last span
+				 */
+				segment_iterator end() const {
+					return segment_iterator(myRow, myFirst, 0);
+				}
+
+				/**
+				 * Returns the number of spans the column is split into
+				 */
+				size_type segments() const {
+					return mySize == 0 ? 0 : (myFirst + mySize - 1) / ROW_SIZE + 1;
+				}
+
+				/**
+				 * Returns the number of elements in the column
+				 */
+				size_type size() const {
+					return mySize;
+				}
+
+				/**
+				 * Returns field K of the indexth element
+				 */
+				T& operator [](size_type index) const {
+					MYDEQUE_CHECK(index < mySize);
+					size_type slot = myFirst + index;
+					return columnOf<K>(myRow[slot >> LOG_ROW_SIZE])[slot & (ROW_SIZE - 1)];
+				}
+		};
+
+	private:
+		// Elements take up the slots from myStart to myStart + mySize,
+		// counting slots from the start of the first row in the map
+		map_pointer myMap;
+		size_type myMapSize;
+		size_type myStart;
+		size_type mySize;
+
+		row_allocator_type myRowAllocator;
+		map_allocator_type myMapAllocator;
+
+	private:
+
+		bool valid() const {
+			return this->validMap();
+		}
+
+		/**
+		 * Helper function to find the row a slot is in
+		 */
+		row_pointer rowAt(size_type slot) const {
+			return myMap[slot >> LOG_ROW_SIZE];
+		}
+
+		/**
+		 * Helper function to find a slot's offset in its row
+		 */
+		static size_type offsetAt(size_type slot) {
+			return slot & (ROW_SIZE - 1);
+		}
+
+		/**
+		 * Helper function to build an iterator to a slot
+		 */
+		iterator iteratorAt(size_type slot) const {
+			return iterator(myMap + (slot >> LOG_ROW_SIZE), offsetAt(slot));
+		}
+
+		/**
+		 * Helper function to allocate one row
+		 */
+		row_pointer allocateRow() {
+			return row_allocator_traits::allocate(myRowAllocator, 1);
+		}
+
+		/**
+		 * Helper function to deallocate one row, if there is one
+		 */
+		void deallocateRow(row_pointer row) {
+			if (row != NULL)
+				row_allocator_traits::deallocate(myRowAllocator, row, 1);
+		}
+
+		/**
+		 * Helper function to allocate a map
+		 */
+		map_pointer allocateMap(size_type n) {
+			return map_allocator_traits::allocate(myMapAllocator, n);
+		}
+
+		/**
+		 * Helper function to deallocate a map
+		 */
+		void deallocateMap(map_pointer map, size_type n) {
+			map_allocator_traits::deallocate(myMapAllocator, map, n);
+		}
+
+		/**
+		 * Helper function to copy that's rows into a map of our own
+		 * Only the rows holding elements are copied, spare rows stay behind
+		 * The fields are trivially copyable, so those rows are copied as they are
+		 */
+		void copyMap(const SoADeque& that) {
+			myMap = allocateMap(that.myMapSize);
+			for (; myMapSize < that.myMapSize; ++myMapSize)
+				myMap[myMapSize] = NULL;
+			try {
+				for (size_type i = myStart >> LOG_ROW_SIZE; i <= (myStart + mySize) >> LOG_ROW_SIZE; ++i) {
+					myMap[i] = allocateRow();
+					std::memcpy(static_cast<void*>(myMap[i]), that.myMap[i], sizeof(row_type));
+				}
+			}
+			catch (...) {
+				destroyMap();
+				throw;
+			}
+		}
+
+		/**
+		 * Exchange rows and maps with another SoADeque, leaving the allocators
+		 */
+		void swapStorage(SoADeque& that) {
+			std::swap(myMap, that.myMap);
+			std::swap(myMapSize, that.myMapSize);
+			std::swap(myStart, that.myStart);
+			std::swap(mySize, that.mySize);
+		}
+
+		// The propagate_on_container_* flags pick among these at compile time,
+		// the same way as in MyDeque
+
+		void swapAllocators(SoADeque&, std::false_type) {}
+
+		void swapAllocators(SoADeque& that, std::true_type) {
+			std::swap(myRowAllocator, that.myRowAllocator);
+			std::swap(myMapAllocator, that.myMapAllocator);
+		}
+
+		void copyAssign(const SoADeque& rhs, std::false_type) {
+			// Our rows have to come from our own allocator
+			SoADeque tmp(rhs, allocator_type(myRowAllocator));
+			swapStorage(tmp);
+		}
+
+		void copyAssign(const SoADeque& rhs, std::true_type) {
+			// tmp frees our rows with the allocator they came from
+			SoADeque tmp(rhs, allocator_type(rhs.myRowAllocator));
+			swapAllocators(tmp, std::true_type());
+			swapStorage(tmp);
+		}
+
+		void moveAssign(SoADeque& rhs, std::true_type) {
+			swapAllocators(rhs, std::true_type());
+			swapStorage(rhs);
+			rhs.clear();
+		}
+
+		void moveAssign(SoADeque& rhs, std::false_type) {
+			if (myRowAllocator == rhs.myRowAllocator) {
+				swapStorage(rhs);
+				rhs.clear();
+			}
+			else
+				copyAssign(rhs, std::false_type());
+		}
+
+	public:
+		/**
+		 * Create an empty SoADeque,
+		 * has a minimum 1 row
+		 */
+		explicit SoADeque(const allocator_type& a = allocator_type()) :
+				myMap(NULL),
+				myMapSize(0),
+				myStart(0),
+				mySize(0),
+				myRowAllocator(a),
+				myMapAllocator(a) {
+			initMap();
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Create a SoADeque of the specified size and fill with the specified
+		 * values. Minimum one row
+		 */
+		explicit SoADeque(size_type s, const value_type& v = value_type(), const allocator_type& a = allocator_type()) :
+				myMap(NULL),
+				myMapSize(0),
+				myStart(0),
+				mySize(0),
+				myRowAllocator(a),
+				myMapAllocator(a) {
+			initMap();
+			for (size_type i = 0; i < s; ++i)
+				push_back(v);
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Copy construct this SoADeque using another
+		 * The allocator is whatever select_on_container_copy_construction picks
+		 */
+		SoADeque(const SoADeque& that) :
+				myMap(NULL),
+				myMapSize(0),
+				myStart(that.myStart),
+				mySize(that.mySize),
+				myRowAllocator(row_allocator_traits::select_on_container_copy_construction(that.myRowAllocator)),
+				myMapAllocator(myRowAllocator) {
+			copyMap(that);
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Copy construct this SoADeque using another and the allocator a
+		 */
+		SoADeque(const SoADeque& that, const allocator_type& a) :
+				myMap(NULL),
+				myMapSize(0),
+				myStart(that.myStart),
+				mySize(that.mySize),
+				myRowAllocator(a),
+				myMapAllocator(a) {
+			copyMap(that);
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Move construct this SoADeque from another in constant time,
+		 * taking over its rows and map
+		 * that is left with a fresh row of its own
+		 */
+		SoADeque(SoADeque&& that) :
+				myMap(NULL),
+				myMapSize(0),
+				myStart(0),
+				mySize(0),
+				myRowAllocator(that.myRowAllocator),
+				myMapAllocator(that.myMapAllocator) {
+			initMap();
+			swapStorage(that);
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Release every row and the map
+		 */
+		~SoADeque() {
+			destroyMap();
+		}
+
+		/**
+		 * Set this SoADeque equal to another
+		 * The allocator follows propagate_on_container_copy_assignment
+		 */
+		SoADeque& operator =(const SoADeque& rhs) {
+			if (this != &rhs)
+				copyAssign(rhs, typename row_allocator_traits::propagate_on_container_copy_assignment());
+			MYDEQUE_INVARIANT(valid());
+			return *this;
+		}
+
+		/**
+		 * Move another SoADeque into this one
+		 * The rows change hands in constant time when the allocator propagates
+		 * on move assignment or the allocators are equal, otherwise they're copied
+		 */
+		SoADeque& operator =(SoADeque&& rhs) {
+			if (this != &rhs)
+				moveAssign(rhs, typename row_allocator_traits::propagate_on_container_move_assignment());
+			MYDEQUE_INVARIANT(valid());
+			return *this;
+		}
+
+		/**
+		 * Index this SoADeque, return a proxy for the indexth element
+		 */
+		reference operator [](size_type index) {
+			MYDEQUE_CHECK(index < mySize);
+			size_type slot = myStart + index;
+			return reference(rowAt(slot), offsetAt(slot));
+		}
+
+		/**
+		 * Index this SoADeque, return a proxy for the indexth element
+		 */
+		const_reference operator [](size_type index) const {
+			return const_cast<SoADeque*>(this)->operator[](index);
+		}
+
+		/**
+		 * Gets the indexth element from the SoADeque
+		 */
+		reference at(size_type index) {
+			if (index >= mySize)
+				throw std::out_of_range("index out of range");
+			return (*this)[index];
+		}
+
+		/**
+		 * Gets the indexth element from the SoADeque
+		 */
+		const_reference at(size_type index) const {
+			return const_cast<SoADeque*>(this)->at(index);
+		}
+
+		/**
+		 * Return the last element
+		 */
+		reference back() {
+			MYDEQUE_CHECK(!empty());
+			return (*this)[mySize - 1];
+		}
+
+		/**
+		 * Return the last element
+		 */
+		const_reference back() const {
+			return const_cast<SoADeque*>(this)->back();
+		}
+
+		/**
+		 * Return an iterator to the first element
+		 */
+		iterator begin() {
+			return iteratorAt(myStart);
+		}
+
+		/**
+		 * Return an iterator to the first element
+		 */
+		const_iterator begin() const {
+			return iteratorAt(myStart);
+		}
+
+		/**
+		 * Returns field K of every element, as one span per row
+		 */
+		template<std::size_t K>
+		column_view<typename field<K>::type, K> column() {
+			return column_view<typename field<K>::type, K>(
+					myMap + (myStart >> LOG_ROW_SIZE), offsetAt(myStart), mySize);
+		}
+
+		/**
+		 * Returns field K of every element, as one span per row
+		 */
+		template<std::size_t K>
+		column_view<const typename field<K>::type, K> column() const {
+			return column_view<const typename field<K>::type, K>(
+					myMap + (myStart >> LOG_ROW_SIZE), offsetAt(myStart), mySize);
+		}
+
+		/**
+		 * Remove every element, deallocating every row but one
+		 * The map keeps its size, so clear() never allocates
+		 */
+		void clear() {
+			clearRows();
+		}
+
+		/**
+		 * Return true if this SoADeque is empty
+		 */
+		bool empty() const {
+			return !size();
+		}
+
+		/**
+		 * Return an iterator past the last element
+		 */
+		iterator end() {
+			return iteratorAt(myStart + mySize);
+		}
+
+		/**
+		 * Return an iterator past the last element
+		 */
+		const_iterator end() const {
+			return iteratorAt(myStart + mySize);
+		}
+
+		/**
+		 * Return the first element
+		 */
+		reference front() {
+			MYDEQUE_CHECK(!empty());
+			return (*this)[0];
+		}
+
+		/**
+		 * Return the first element
+		 */
+		const_reference front() const {
+			return const_cast<SoADeque*>(this)->front();
+		}
+
+		/**
+		 * Returns a copy of the allocator the rows come from
+		 */
+		allocator_type get_allocator() const {
+			return allocator_type(myRowAllocator);
+		}
+
+		/**
+		 * Remove the last element
+		 */
+		void pop_back() {
+			MYDEQUE_CHECK(!empty());
+			--mySize;
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Remove the first element
+		 */
+		void pop_front() {
+			MYDEQUE_CHECK(!empty());
+			++myStart;
+			--mySize;
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Add an element to the back
+		 */
+		void push_back(const value_type& v) {
+			// Only the first element of a row needs a new row for end()
+			if (((myStart + mySize + 1) & (ROW_SIZE - 1)) == 0)
+				reserveBack(1);
+			size_type slot = myStart + mySize;
+			store(rowAt(slot), offsetAt(slot), v, indices());
+			++mySize;
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Add an element to the front
+		 */
+		void push_front(const value_type& v) {
+			if ((myStart & (ROW_SIZE - 1)) == 0)
+				reserveFront(1);
+			--myStart;
+			store(rowAt(myStart), offsetAt(myStart), v, indices());
+			++mySize;
+			MYDEQUE_INVARIANT(valid());
+		}
+
+		/**
+		 * Return the number of elements in this SoADeque
+		 */
+		size_type size() const {
+			return mySize;
+		}
+
+		/**
+		 * Swap the contents of this SoADeque with another
+		 * The allocators follow propagate_on_container_swap
+		 */
+		void swap(SoADeque& that) {
+			// Like std::deque, swapping unequal allocators that don't
+			// propagate on swap is undefined, so it's only checked
+			if (!row_allocator_traits::propagate_on_container_swap::value)
+				MYDEQUE_CHECK(myRowAllocator == that.myRowAllocator);
+			swapAllocators(that, typename row_allocator_traits::propagate_on_container_swap());
+			swapStorage(that);
+			MYDEQUE_INVARIANT(valid());
+		}
+};
+
+#endif // SoADeque_h
@@ -0,0 +1,220 @@
+/*
+ * TestAsyncQueue
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++20 -Wall TestAsyncQueue.c++ -o TestAsyncQueue -lgtest -lgtest_main -lpthread
+ *
+ * Then it can run with
+ * TestAsyncQueue
+ */
+
+#include <coroutine> // coroutine_handle
+#include <cstddef>   // size_t
+#include <memory>    // unique_ptr
+#include <string>    // string
+#include <vector>    // vector
+
+#include "gtest/gtest.h" // Google Test framework
+
+#include "AsyncQueue.h"
+#include "DequeTestSupport.h"
+
+namespace {
+	/**
+	 * Collects the consumers an AsyncQueue resumes, to run them later
+	 */
+	class Scheduler {
+		private:
+			std::vector<std::coroutine_handle<> > ready;
+
+		public:
+			void schedule(std::coroutine_handle<> h) {
+				ready.push_back(h);
+			}
+
+			std::size_t pending() const {
+				return ready.size();
+			}
+
+			void run() {
+				std::vector<std::coroutine_handle<> > now;
+				now.swap(ready);
+				for (std::size_t i = 0; i < now.size(); ++i)
+					now[i].resume();
+			}
+	};
+
+	template<typename T>
+	Task popInto(AsyncQueue<T>& q, std::vector<T>& out) {
+		out.push_back(co_await q.pop());
+	}
+
+	template<typename T>
+	Task popNInto(AsyncQueue<T>& q, std::size_t k, std::vector<std::vector<T> >& out) {
+		out.push_back(co_await q.pop_n(k));
+	}
+
+	/**
+	 * Sums everything popped until a negative item
+	 */
+	Task sumUntilNegative(AsyncQueue<int>& q, long& sum, bool& done) {
+		for (;;) {
+			int v = co_await q.pop();
+			if (v < 0)
+				break;
+			sum += v;
+		}
+		done = true;
+	}
+}
+
+TEST(AsyncQueueTest, PopReadyItemsWithoutSuspending) {
+	AsyncQueue<int> q;
+	q.push_back(1);
+	q.push_back(2);
+	std::vector<int> out;
+	popInto(q, out);
+	popInto(q, out);
+	ASSERT_EQ(2, out.size());
+	EXPECT_EQ(1, out[0]);
+	EXPECT_EQ(2, out[1]);
+	EXPECT_TRUE(q.empty());
+	EXPECT_EQ(0, q.waiting());
+}
+
+TEST(AsyncQueueTest, PopSuspendsUntilPush) {
+	AsyncQueue<int> q;
+	std::vector<int> out;
+	popInto(q, out);
+	EXPECT_TRUE(out.empty());
+	EXPECT_EQ(1, q.waiting());
+
+	// Resumed inline, so the item has arrived before push_back returns
+	q.push_back(5);
+	ASSERT_EQ(1, out.size());
+	EXPECT_EQ(5, out[0]);
+	EXPECT_EQ(0, q.waiting());
+	EXPECT_TRUE(q.empty());
+}
+
+TEST(AsyncQueueTest, WaitersResumeInOrder) {
+	AsyncQueue<std::string> q;
+	std::vector<std::string> first, second, third;
+	popInto(q, first);
+	popInto(q, second);
+	popInto(q, third);
+	EXPECT_EQ(3, q.waiting());
+
+	q.push_back("a");
+	q.push_back(std::string("b"));
+	q.push_back("c");
+	q.push_back("d");
+	ASSERT_EQ(1, first.size());
+	ASSERT_EQ(1, second.size());
+	ASSERT_EQ(1, third.size());
+	EXPECT_EQ("a", first[0]);
+	EXPECT_EQ("b", second[0]);
+	EXPECT_EQ("c", third[0]);
+	EXPECT_EQ(1, q.size());
+}
+
+TEST(AsyncQueueTest, SchedulerDefersResume) {
+	Scheduler s;
+	AsyncQueue<int> q([&s](std::coroutine_handle<> h) { s.schedule(h); });
+	std::vector<int> first, second;
+	popInto(q, first);
+	popInto(q, second);
+
+	q.push_back(1);
+	q.push_back(2);
+	q.push_back(3);
+	EXPECT_TRUE(first.empty());
+	EXPECT_EQ(2, s.pending());
+	EXPECT_EQ(1, q.size());
+
+	s.run();
+	ASSERT_EQ(1, first.size());
+	ASSERT_EQ(1, second.size());
+	EXPECT_EQ(1, first[0]);
+	EXPECT_EQ(2, second[0]);
+}
+
+TEST(AsyncQueueTest, PopNTakesUpToK) {
+	AsyncQueue<int> q;
+	for (int i = 0; i < 10; ++i)
+		q.push_back(i);
+
+	std::vector<std::vector<int> > out;
+	popNInto(q, 4, out);
+	popNInto(q, 100, out);
+	ASSERT_EQ(2, out.size());
+	ASSERT_EQ(4, out[0].size());
+	ASSERT_EQ(6, out[1].size());
+	for (int i = 0; i < 4; ++i)
+		EXPECT_EQ(i, out[0][i]);
+	for (int i = 0; i < 6; ++i)
+		EXPECT_EQ(4 + i, out[1][i]);
+}
+
+TEST(AsyncQueueTest, PopNWaitsForOneInline) {
+	AsyncQueue<int> q;
+	std::vector<std::vector<int> > out;
+	popNInto(q, 8, out);
+	EXPECT_TRUE(out.empty());
+	q.push_back(7);
+	q.push_back(8);
+	ASSERT_EQ(1, out.size());
+	ASSERT_EQ(1, out[0].size());
+	EXPECT_EQ(7, out[0][0]);
+	EXPECT_EQ(1, q.size());
+}
+
+TEST(AsyncQueueTest, PopNBatchesWhatArrivesBeforeItRuns) {
+	Scheduler s;
+	AsyncQueue<int> q([&s](std::coroutine_handle<> h) { s.schedule(h); });
+	std::vector<std::vector<int> > out;
+	popNInto(q, 4, out);
+	for (int i = 0; i < 6; ++i)
+		q.push_back(i);
+	s.run();
+	ASSERT_EQ(1, out.size());
+	ASSERT_EQ(4, out[0].size());
+	for (int i = 0; i < 4; ++i)
+		EXPECT_EQ(i, out[0][i]);
+	EXPECT_EQ(2, q.size());
+}
+
+TEST(AsyncQueueTest, ConsumerLoop) {
+	AsyncQueue<int> q;
+	long sum = 0;
+	bool done = false;
+	sumUntilNegative(q, sum, done);
+	for (int i = 0; i < 100000; ++i)
+		q.push_back(i);
+	EXPECT_FALSE(done);
+	q.push_back(-1);
+	EXPECT_TRUE(done);
+	EXPECT_EQ(100000L * 99999 / 2, sum);
+}
+
+TEST(AsyncQueueTest, MoveOnlyItems) {
+	AsyncQueue<std::unique_ptr<int> > q;
+	std::vector<std::unique_ptr<int> > out;
+	popInto(q, out);
+	// Handed straight to the waiting consumer
+	q.push_back(std::unique_ptr<int>(new int(1)));
+	// Queued, then taken
+	for (int i = 2; i < 300; ++i)
+		q.push_back(std::unique_ptr<int>(new int(i)));
+	popInto(q, out);
+
+	std::vector<std::vector<std::unique_ptr<int> > > batches;
+	popNInto(q, 500, batches);
+	ASSERT_EQ(2, out.size());
+	EXPECT_EQ(1, *out[0]);
+	EXPECT_EQ(2, *out[1]);
+	ASSERT_EQ(1, batches.size());
+	ASSERT_EQ(297, batches[0].size());
+	EXPECT_EQ(299, *batches[0].back());
+	EXPECT_TRUE(q.empty());
+}
@@ -0,0 +1,258 @@
+/*
+ * TestCompressedDeque
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++0x -Wall TestCompressedDeque.c++ -o TestCompressedDeque -lgtest -lgtest_main -lpthread
+ *
+ * Then it can run with
+ * TestCompressedDeque
+ */
+
+#include <cstdint>   // int32_t, int64_t
+#include <deque>     // deque
+#include <limits>    // numeric_limits
+#include <stdexcept> // out_of_range
+
+#include "gtest/gtest.h" // Google Test framework
+
+#include "CompressedDeque.h"
+#include "DequeTestSupport.h"
+
+namespace {
+	typedef CompressedDeque<std::int64_t> History;
+
+	template<typename C, typename T>
+	void expectSame(const C& x, const std::deque<T>& y) {
+		ASSERT_EQ(y.size(), x.size());
+		for (std::size_t i = 0; i < y.size(); ++i)
+			ASSERT_EQ(y[i], x[i]) << "at " << i;
+	}
+}
+
+// --- plain ---
+
+TEST(CompressedDequeTest, Empty) {
+	History x;
+	EXPECT_TRUE(x.empty());
+	EXPECT_EQ(0, x.size());
+	EXPECT_EQ(0, x.rows());
+	EXPECT_EQ(0, x.resident_bytes());
+}
+
+TEST(CompressedDequeTest, PushAndPopBothEnds) {
+	History x;
+	std::deque<std::int64_t> y;
+	for (int i = 0; i < 1000; ++i) {
+		x.push_back(i);
+		y.push_back(i);
+		x.push_front(-i);
+		y.push_front(-i);
+	}
+	expectSame(x, y);
+	EXPECT_EQ(-999, x.front());
+	EXPECT_EQ(999, x.back());
+
+	while (x.size() > 10) {
+		x.pop_front();
+		y.pop_front();
+		x.pop_back();
+		y.pop_back();
+	}
+	expectSame(x, y);
+	x.clear();
+	EXPECT_TRUE(x.empty());
+	EXPECT_EQ(0, x.rows());
+}
+
+TEST(CompressedDequeTest, AtThrows) {
+	History x;
+	x.push_back(1);
+	EXPECT_EQ(1, x.at(0));
+	EXPECT_THROW(x.at(1), std::out_of_range);
+}
+
+TEST(CompressedDequeTest, NeverPacksWithoutColdAfter) {
+	History x;
+	for (int i = 0; i < 100000; ++i)
+		x.push_back(7);
+	EXPECT_EQ(0, x.compressed_rows());
+}
+
+// --- packing ---
+
+TEST(CompressedDequeTest, CompressPacksInteriorRows) {
+	History x;
+	std::deque<std::int64_t> y;
+	for (std::int64_t i = 0; i < 128 * 20; ++i) {
+		x.push_back(1000000000000LL + i);
+		y.push_back(1000000000000LL + i);
+	}
+	std::size_t before = x.resident_bytes();
+	x.compress();
+
+	// Twenty rows, two hot at each end, each of the rest 7 bits wide
+	EXPECT_EQ(16, x.compressed_rows());
+	EXPECT_EQ(4 * 128 * 8 + 16 * 128 * 7 / 8, x.resident_bytes());
+	EXPECT_LT(x.resident_bytes(), before / 3);
+	expectSame(x, y);
+}
+
+TEST(CompressedDequeTest, ConstantRowsTakeNoWords) {
+	History x(0, 1);
+	for (int i = 0; i < 128 * 5; ++i)
+		x.push_back(-42);
+	x.compress();
+	EXPECT_EQ(3, x.compressed_rows());
+	EXPECT_EQ(2 * 128 * 8, x.resident_bytes());
+	EXPECT_EQ(-42, x[300]);
+}
+
+TEST(CompressedDequeTest, WideRowsStayPlain) {
+	History x(0, 1);
+	std::deque<std::int64_t> y;
+	for (int i = 0; i < 128 * 3; ++i) {
+		std::int64_t v = i % 2 ? std::numeric_limits<std::int64_t>::max() : std::numeric_limits<std::int64_t>::min();
+		x.push_back(v);
+		y.push_back(v);
+	}
+	x.compress();
+	EXPECT_EQ(0, x.compressed_rows());
+	expectSame(x, y);
+}
+
+TEST(CompressedDequeTest, NegativeAndWideValues) {
+	History x(0, 1);
+	std::deque<std::int64_t> y;
+	Samples s(7);
+	for (int i = 0; i < 128 * 40; ++i) {
+		// Rows of every width from 1 to 40 bits, straddling zero
+		std::int64_t v = s.next(1L << (i / 128 % 31 + 1)) - (1L << (i / 128 % 31));
+		if (i / 128 > 30)
+			v *= 1L << 9;
+		x.push_back(v);
+		y.push_back(v);
+	}
+	x.compress();
+	EXPECT_EQ(38, x.compressed_rows());
+	expectSame(x, y);
+}
+
+TEST(CompressedDequeTest, NarrowIntegers) {
+	CompressedDeque<std::int32_t> x(0, 1);
+	std::deque<std::int32_t> y;
+	for (int i = 0; i < 128 * 4; ++i) {
+		x.push_front(i % 3 - 1);
+		y.push_front(i % 3 - 1);
+	}
+	x.compress();
+	EXPECT_EQ(2, x.compressed_rows());
+	expectSame(x, y);
+}
+
+TEST(CompressedDequeTest, SetUnpacksRow) {
+	History x(0, 1);
+	for (int i = 0; i < 128 * 3; ++i)
+		x.push_back(i);
+	x.compress();
+	ASSERT_EQ(1, x.compressed_rows());
+	x.set(200, -5);
+	EXPECT_EQ(0, x.compressed_rows());
+	EXPECT_EQ(-5, x[200]);
+	EXPECT_EQ(199, x[199]);
+	EXPECT_EQ(201, x[201]);
+}
+
+TEST(CompressedDequeTest, PoppingIntoPackedRowsUnpacksThem) {
+	History x(0, 1);
+	std::deque<std::int64_t> y;
+	for (int i = 0; i < 128 * 6; ++i) {
+		x.push_back(i);
+		y.push_back(i);
+	}
+	x.compress();
+	ASSERT_EQ(4, x.compressed_rows());
+	for (int i = 0; i < 128 * 2; ++i) {
+		x.pop_back();
+		y.pop_back();
+		x.pop_front();
+		y.pop_front();
+	}
+	EXPECT_EQ(0, x.compressed_rows());
+	expectSame(x, y);
+
+	x.push_back(-1);
+	y.push_back(-1);
+	x.push_front(-2);
+	y.push_front(-2);
+	expectSame(x, y);
+}
+
+// --- cold rows ---
+
+TEST(CompressedDequeTest, AppendOnlyHistoryGoesCold) {
+	History x(1024);
+	std::deque<std::int64_t> y;
+	std::int64_t t = 1600000000000LL;
+	Samples s(3);
+	for (int i = 0; i < 128 * 200; ++i) {
+		t += 1000 + s.next(50);
+		x.push_back(t);
+		y.push_back(t);
+	}
+	// Every row but the hot ends and the ones written in the last 1024 ticks
+	EXPECT_GE(x.compressed_rows(), 200 - 4 - 1024 / 128);
+	EXPECT_LT(x.resident_bytes(), 128 * 200 * 8 / 3);
+	expectSame(x, y);
+}
+
+TEST(CompressedDequeTest, RecentlyWrittenRowsStayPlain) {
+	History x(1000000);
+	for (int i = 0; i < 128 * 50; ++i)
+		x.push_back(i);
+	EXPECT_EQ(0, x.compressed_rows());
+}
+
+TEST(CompressedDequeTest, RandomOperations) {
+	History x(64, 1);
+	std::deque<std::int64_t> y;
+	Samples s(11);
+	for (int i = 0; i < 200000; ++i) {
+		switch (s.next(10)) {
+			case 0: case 1: case 2:
+				x.push_back(i % 1000);
+				y.push_back(i % 1000);
+				break;
+			case 3: case 4:
+				x.push_front(-i % 500);
+				y.push_front(-i % 500);
+				break;
+			case 5:
+				if (!y.empty()) {
+					x.pop_back();
+					y.pop_back();
+				}
+				break;
+			case 6:
+				if (!y.empty()) {
+					x.pop_front();
+					y.pop_front();
+				}
+				break;
+			case 7:
+				if (!y.empty()) {
+					std::size_t index = s.next(y.size());
+					x.set(index, i);
+					y[index] = i;
+				}
+				break;
+			default:
+				if (!y.empty()) {
+					std::size_t index = s.next(y.size());
+					ASSERT_EQ(y[index], x[index]);
+				}
+				break;
+		}
+	}
+	EXPECT_GT(x.compressed_rows(), 0);
+	expectSame(x, y);
+}
@@ -10,18 +10,28 @@
  * It will work on any machine with gtest and the precompiled libraries installed
  */
 
-#include <algorithm> // equal
+#include <algorithm> // equal, reverse, sort
 #include <cstring>   // strcmp
 #include <deque>     // deque
-#include <sstream>   // ostringstream
+#include <sstream>   // istringstream, ostringstream
 #include <stdexcept> // invalid_argument
 #include <string>    // ==
+#include <vector>    // vector
+
+#if __cplusplus >= 201703L
+#include <memory_resource> // monotonic_buffer_resource, polymorphic_allocator
+#endif
 
 // Stuff in deque.h so they don't get compile errors when we use the defines
 // to make all members of deque public
 #include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 #include <iterator>
 #include <memory>
+#include <type_traits>
 #include <utility>
 
 #include "gtest/gtest.h" // Google Test framework
@@ -36,7 +46,7 @@
 // Not testing the code we didn't write
 // destroy, unitialized_copy, unitialized_fill
 
-typedef testing::Types<std::deque<int>, MyDeque<int> > MyDeques;
+typedef testing::Types<std::deque<int>, MyDeque<int>, MyDeque<int, std::allocator<int>, true> > MyDeques;
 // --- Deque Interface tests ---
 // These are tests that both deques should pass
 
@@ -294,6 +304,11 @@ TYPED_TEST(DequeTest, AtSizeMinusOneWhenSizeIsLarge) {
 	EXPECT_EQ(9, this->x.at(this->x.size() - 1));
 }
 
+TYPED_TEST(DequeTest, AtSizeThrows) {
+	this->SetSame();
+	EXPECT_THROW(this->x.at(this->x.size()), std::out_of_range);
+}
+
 // --- back ---
 
 TYPED_TEST(DequeTest, BackWhenSizeIsOne) {
@@ -953,6 +968,25 @@ TYPED_TEST(IteratorTest, Erase) {
 	EXPECT_EQ(1, *(this->x.begin()));
 }
 
+TYPED_TEST(IteratorTest, EraseMatchesStdDeque) {
+	std::deque<int> expected;
+	for (int k = 0; k < 1000; ++k) {
+		this->x.push_back(k);
+		expected.push_back(k);
+	}
+	for (int k = 0; k < 900; ++k) {
+		const int index = (k * 7919) % expected.size();
+		typename TestFixture::iterator r = this->x.erase(this->x.begin() + index);
+		expected.erase(expected.begin() + index);
+		ASSERT_EQ(expected.size(), this->x.size());
+		if (index < static_cast<int>(expected.size()))
+			ASSERT_EQ(expected[index], *r);
+		else
+			ASSERT_TRUE(r == this->x.end());
+	}
+	EXPECT_TRUE(std::equal(expected.begin(), expected.end(), this->x.begin()));
+}
+
 TYPED_TEST(IteratorTest, EraseLarge) {
 	this->SetUpBegin();
 	this->Push();
@@ -964,7 +998,31 @@ TYPED_TEST(IteratorTest, EraseLarge) {
 }
 
 // --- insert ---
-// TODO
+
+TYPED_TEST(IteratorTest, InsertMatchesStdDeque) {
+	std::deque<int> expected;
+	for (int k = 0; k < 1000; ++k) {
+		const int index = expected.empty() ? 0 : (k * 7919) % (expected.size() + 1);
+		typename TestFixture::iterator r = this->x.insert(this->x.begin() + index, k);
+		expected.insert(expected.begin() + index, k);
+		ASSERT_EQ(k, *r);
+	}
+	ASSERT_EQ(expected.size(), this->x.size());
+	EXPECT_TRUE(std::equal(expected.begin(), expected.end(), this->x.begin()));
+}
+
+TYPED_TEST(IteratorTest, InsertOwnElement) {
+	this->SetUpBegin();
+	this->x.insert(this->x.begin() + 1, this->x[2]);
+	this->x.insert(this->x.begin() + 3, this->x[0]);
+	ASSERT_EQ(5, this->x.size());
+	EXPECT_EQ(0, this->x[0]);
+	EXPECT_EQ(2, this->x[1]);
+	EXPECT_EQ(1, this->x[2]);
+	EXPECT_EQ(0, this->x[3]);
+	EXPECT_EQ(2, this->x[4]);
+}
+
 TYPED_TEST(IteratorTest, InsertEmpty) {
 	EXPECT_EQ(0, this->x.size());
 	this->x.insert(this->x.begin(), 1);
@@ -1143,4 +1201,721 @@ TEST_F(MyDequeTest, DeallocateMapLarge) {
 	const map_pointer p = x.myMapAllocator.allocate(large);
 	ASSERT_NE(static_cast<const map_pointer>(NULL), p);
 	x.myMapAllocator.deallocate(p, large);
-}
\ No newline at end of file
+}
+// --- pop_front(n) ---
+
+TEST_F(MyDequeTest, PopFrontBulkSmall) {
+	for (int i = 0; i < 10; ++i)
+		x.push_back(i);
+	x.pop_front(4);
+	ASSERT_EQ(6, x.size());
+	EXPECT_EQ(4, x.front());
+	EXPECT_EQ(9, x.back());
+}
+
+TEST_F(MyDequeTest, PopFrontBulkKeepsRows) {
+	for (int i = 0; i < 1000; ++i)
+		x.push_back(i);
+	const size_type mapSize = x.myMapSize;
+	const int* row = x.myMap[0];
+	x.pop_front(900);
+	ASSERT_EQ(100, x.size());
+	EXPECT_EQ(900, x.front());
+	EXPECT_EQ(999, x.back());
+	EXPECT_EQ(mapSize, x.myMapSize);
+	EXPECT_EQ(row, x.myMap[0]);
+
+	x.shrink_to_fit();
+	EXPECT_LT(x.myMapSize, mapSize);
+	EXPECT_LT(x.myStart, static_cast<size_type>(container::ROW_SIZE));
+	EXPECT_EQ(900, x.front());
+	EXPECT_EQ(999, x.back());
+}
+
+TEST_F(MyDequeTest, PopFrontBulkAll) {
+	for (int i = 0; i < 1000; ++i)
+		x.push_back(i);
+	x.pop_front(x.size());
+	EXPECT_TRUE(x.empty());
+	x.push_front(3);
+	x.push_back(4);
+	EXPECT_EQ(3, x.front());
+	EXPECT_EQ(4, x.back());
+}
+
+// --- pop_back(n) ---
+
+TEST_F(MyDequeTest, PopBackBulkSmall) {
+	for (int i = 0; i < 10; ++i)
+		x.push_back(i);
+	x.pop_back(4);
+	ASSERT_EQ(6, x.size());
+	EXPECT_EQ(0, x.front());
+	EXPECT_EQ(5, x.back());
+}
+
+TEST_F(MyDequeTest, PopBackBulkKeepsRows) {
+	for (int i = 0; i < 1000; ++i)
+		x.push_front(i);
+	const size_type mapSize = x.myMapSize;
+	x.pop_back(900);
+	ASSERT_EQ(100, x.size());
+	EXPECT_EQ(999, x.front());
+	EXPECT_EQ(900, x.back());
+	EXPECT_EQ(mapSize, x.myMapSize);
+
+	x.shrink_to_fit();
+	EXPECT_LT(x.myMapSize, mapSize);
+	EXPECT_EQ(x.myMapSize - 1, (x.myStart + x.mySize) / container::ROW_SIZE);
+	EXPECT_EQ(999, x.front());
+	EXPECT_EQ(900, x.back());
+}
+
+// --- drain_front ---
+
+TEST_F(MyDequeTest, DrainFrontToArray) {
+	for (int i = 0; i < 1000; ++i)
+		x.push_back(i);
+	std::vector<int> out(600);
+	int* e = x.drain_front(600, &out[0]);
+	EXPECT_EQ(&out[0] + 600, e);
+	for (int i = 0; i < 600; ++i)
+		ASSERT_EQ(i, out[i]);
+	ASSERT_EQ(400, x.size());
+	EXPECT_EQ(600, x.front());
+}
+
+TEST_F(MyDequeTest, DrainFrontToBackInserter) {
+	MyDeque<std::string> y;
+	for (int i = 0; i < 300; ++i)
+		y.push_back(std::string(i % 7 + 1, 'a' + i % 26));
+	std::vector<std::string> out;
+	y.drain_front(200, std::back_inserter(out));
+	ASSERT_EQ(200, out.size());
+	ASSERT_EQ(100, y.size());
+	for (int i = 0; i < 200; ++i)
+		ASSERT_EQ(std::string(i % 7 + 1, 'a' + i % 26), out[i]);
+	EXPECT_EQ(std::string(200 % 7 + 1, 'a' + 200 % 26), y.front());
+}
+
+// --- append ---
+
+TEST_F(MyDequeTest, AppendRange) {
+	std::vector<int> in;
+	for (int i = 0; i < 1000; ++i)
+		in.push_back(i);
+	x.push_back(-1);
+	x.append(in.begin(), in.end());
+	ASSERT_EQ(1001, x.size());
+	EXPECT_EQ(-1, x.front());
+	for (int i = 0; i < 1000; ++i)
+		ASSERT_EQ(i, x[i + 1]);
+}
+
+TEST_F(MyDequeTest, AppendBuffer) {
+	int in[1000];
+	for (int i = 0; i < 1000; ++i)
+		in[i] = i;
+	x.append(in, 1000);
+	x.append(in, 1000);
+	ASSERT_EQ(2000, x.size());
+	for (int i = 0; i < 2000; ++i)
+		ASSERT_EQ(i % 1000, x[i]);
+	EXPECT_EQ(999, x.back());
+}
+
+TEST_F(MyDequeTest, AppendInputRange) {
+	std::istringstream in("1 2 3 4 5");
+	x.append(std::istream_iterator<int>(in), std::istream_iterator<int>());
+	ASSERT_EQ(5, x.size());
+	EXPECT_EQ(1, x.front());
+	EXPECT_EQ(5, x.back());
+}
+
+TEST_F(MyDequeTest, AppendStrings) {
+	std::vector<std::string> in;
+	for (int i = 0; i < 300; ++i)
+		in.push_back(std::string(i % 5 + 1, 'a' + i % 26));
+	MyDeque<std::string> y;
+	y.append(&in[0], in.size());
+	ASSERT_EQ(300, y.size());
+	for (int i = 0; i < 300; ++i)
+		ASSERT_EQ(in[i], y[i]);
+}
+
+// --- prepend ---
+
+TEST_F(MyDequeTest, PrependBuffer) {
+	int in[1000];
+	for (int i = 0; i < 1000; ++i)
+		in[i] = i;
+	x.push_back(1000);
+	x.prepend(in, 1000);
+	ASSERT_EQ(1001, x.size());
+	for (int i = 0; i < 1001; ++i)
+		ASSERT_EQ(i, x[i]);
+	x.push_front(-1);
+	EXPECT_EQ(-1, x.front());
+}
+
+TEST_F(MyDequeTest, PrependInputRange) {
+	std::istringstream in("1 2 3 4 5");
+	x.push_back(6);
+	x.prepend(std::istream_iterator<int>(in), std::istream_iterator<int>());
+	ASSERT_EQ(6, x.size());
+	for (int i = 0; i < 6; ++i)
+		ASSERT_EQ(i + 1, x[i]);
+}
+
+// --- assign ---
+
+TEST_F(MyDequeTest, AssignRange) {
+	for (int i = 0; i < 500; ++i)
+		x.push_back(i);
+	std::vector<int> in(700, 7);
+	x.assign(in.begin(), in.end());
+	ASSERT_EQ(700, x.size());
+	EXPECT_EQ(7, x.front());
+	EXPECT_EQ(7, x.back());
+}
+
+TEST_F(MyDequeTest, AssignCount) {
+	for (int i = 0; i < 500; ++i)
+		x.push_back(i);
+	x.assign(3, 7);
+	ASSERT_EQ(3, x.size());
+	EXPECT_EQ(7, x.front());
+	EXPECT_EQ(7, x.back());
+
+	// The value may be one of the elements being replaced
+	x.front() = 9;
+	x.assign(700, x.front());
+	ASSERT_EQ(700, x.size());
+	for (int i = 0; i < 700; ++i)
+		ASSERT_EQ(9, x[i]);
+}
+
+TEST_F(MyDequeTest, CopyConstructorLarge) {
+	for (int i = 0; i < 1000; ++i)
+		x.push_back(i);
+	container z (x);
+	ASSERT_EQ(1000, z.size());
+	for (int i = 0; i < 1000; ++i)
+		ASSERT_EQ(i, z[i]);
+}
+
+// --- row reuse ---
+
+TEST_F(MyDequeTest, QueueReusesRows) {
+	for (int i = 0; i < 1000; ++i)
+		x.push_back(i);
+	const size_type mapSize = x.myMapSize;
+	for (int i = 1000; i < 100000; ++i) {
+		x.push_back(i);
+		ASSERT_EQ(i - 1000, x.front());
+		x.pop_front();
+	}
+	EXPECT_EQ(mapSize, x.myMapSize);
+	EXPECT_EQ(99000, x.front());
+	EXPECT_EQ(99999, x.back());
+}
+
+TEST_F(MyDequeTest, ReverseQueueReusesRows) {
+	for (int i = 0; i < 1000; ++i)
+		x.push_front(i);
+	const size_type mapSize = x.myMapSize;
+	for (int i = 1000; i < 100000; ++i) {
+		x.push_front(i);
+		ASSERT_EQ(i - 1000, x.back());
+		x.pop_back();
+	}
+	EXPECT_EQ(mapSize, x.myMapSize);
+	EXPECT_EQ(99999, x.front());
+	EXPECT_EQ(99000, x.back());
+}
+
+// --- iterator difference ---
+
+TEST_F(MyDequeTest, IteratorDifferenceAcrossRows) {
+	for (int i = 0; i < 1000; ++i) {
+		x.push_back(i);
+		x.push_front(-i);
+	}
+	const container& y = x;
+	for (difference_type i = 0; i <= 2000; i += 37)
+		for (difference_type j = 0; j <= 2000; j += 53) {
+			ASSERT_EQ(i - j, (x.begin() + i) - (x.begin() + j));
+			ASSERT_EQ(i - j, (y.begin() + i) - (y.begin() + j));
+		}
+	EXPECT_EQ(2000, x.end() - x.begin());
+	EXPECT_EQ(2000, y.end() - y.begin());
+}
+
+TEST_F(MyDequeTest, IteratorsAreRandomAccess) {
+	static_assert(std::is_same<std::iterator_traits<iterator>::iterator_category, std::random_access_iterator_tag>::value, "iterator");
+	static_assert(std::is_same<std::iterator_traits<const_iterator>::iterator_category, std::random_access_iterator_tag>::value, "const_iterator");
+	for (int i = 0; i < 1000; ++i)
+		x.push_front(999 - i);
+
+	iterator b = x.begin();
+	const_iterator c = x.begin() + 300;
+	EXPECT_EQ(700, b[700]);
+	EXPECT_EQ(900, c[600]);
+	EXPECT_EQ(250, *(250 + b));
+	EXPECT_EQ(550, *(250 + c));
+	EXPECT_TRUE(b < c);
+	EXPECT_TRUE(c > b);
+	EXPECT_TRUE(b <= c);
+	EXPECT_TRUE(c >= b);
+	EXPECT_TRUE(b + 300 == c);
+	EXPECT_TRUE(c != b);
+	EXPECT_TRUE(b + 300 <= c);
+	EXPECT_TRUE(c >= b + 300);
+	EXPECT_EQ(300, c - b);
+	EXPECT_EQ(-300, b - c);
+
+	// A MyDeque source is measured in constant time, and lands in order
+	container y;
+	y.append(x.begin() + 100, x.end());
+	y.prepend(x.begin(), x.begin() + 100);
+	EXPECT_TRUE(x == y);
+
+	std::reverse(x.begin(), x.end());
+	EXPECT_EQ(999, x.front());
+	std::sort(x.begin(), x.end());
+	EXPECT_TRUE(x == y);
+}
+
+// --- move-only elements ---
+
+TEST_F(MyDequeTest, PushMovesOnlyElements) {
+	MyDeque<std::unique_ptr<int> > y;
+	for (int i = 0; i < 300; ++i) {
+		y.push_back(std::unique_ptr<int>(new int(i)));
+		y.push_front(std::unique_ptr<int>(new int(-i)));
+	}
+	ASSERT_EQ(600, y.size());
+	EXPECT_EQ(-299, *y.front());
+	EXPECT_EQ(299, *y.back());
+	std::unique_ptr<int> p(std::move(y.front()));
+	y.pop_front();
+	EXPECT_EQ(-299, *p);
+	EXPECT_EQ(-298, *y.front());
+}
+
+// --- small buffer ---
+
+TEST_F(MyDequeTest, SmallBufferStaysInline) {
+	MyDeque<int, std::allocator<int>, true> y;
+	for (int i = 0; i < 50; ++i)
+		y.push_back(i);
+	EXPECT_TRUE(y.mySmallBuffer.ownsMap(y.myMap));
+	EXPECT_TRUE(y.mySmallBuffer.ownsRow(*y.myMap));
+	EXPECT_EQ(1, y.myMapSize);
+}
+
+TEST_F(MyDequeTest, SmallBufferSpillsOnOverflow) {
+	MyDeque<int, std::allocator<int>, true> y;
+	for (int i = 0; i < 1000; ++i) {
+		y.push_back(i);
+		y.push_front(-i);
+	}
+	EXPECT_FALSE(y.mySmallBuffer.ownsMap(y.myMap));
+	ASSERT_EQ(2000, y.size());
+	EXPECT_EQ(-999, y.front());
+	EXPECT_EQ(999, y.back());
+	y.pop_front(1990);
+	EXPECT_EQ(990, y.front());
+	y.shrink_to_fit();
+	EXPECT_EQ(1, y.myMapSize);
+	EXPECT_EQ(990, y.front());
+}
+
+TEST_F(MyDequeTest, SmallBufferSwap) {
+	MyDeque<std::string, std::allocator<std::string>, true> y, z;
+	for (int i = 0; i < 10; ++i)
+		y.push_back(std::string(20, 'a' + i));
+	for (int i = 0; i < 300; ++i)
+		z.push_front(std::string(20, 'a' + i % 26));
+	y.swap(z);
+	ASSERT_EQ(300, y.size());
+	ASSERT_EQ(10, z.size());
+	for (int i = 0; i < 10; ++i)
+		EXPECT_EQ(std::string(20, 'a' + i), z[i]);
+	EXPECT_EQ(std::string(20, 'a' + 299 % 26), y.front());
+	EXPECT_FALSE(z.mySmallBuffer.ownsMap(z.myMap));
+	z.push_back("b");
+	EXPECT_EQ("b", z.back());
+}
+
+// --- allocators ---
+
+/**
+ * A stateful allocator that charges every allocation to the arena named by
+ * its id, with all three propagate_on_container_* flags set to Propagate
+ */
+struct ArenaCounts {
+	static int live[3];
+	static int allocations[3];
+};
+
+int ArenaCounts::live[3] = {0, 0, 0};
+int ArenaCounts::allocations[3] = {0, 0, 0};
+
+template<typename T, bool Propagate>
+struct ArenaAllocator {
+	typedef T value_type;
+	typedef std::integral_constant<bool, Propagate> propagate_on_container_copy_assignment;
+	typedef std::integral_constant<bool, Propagate> propagate_on_container_move_assignment;
+	typedef std::integral_constant<bool, Propagate> propagate_on_container_swap;
+
+	template<typename U>
+	struct rebind {
+		typedef ArenaAllocator<U, Propagate> other;
+	};
+
+	int id;
+
+	explicit ArenaAllocator(int i) : id(i) {}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U, Propagate>& that) : id(that.id) {}
+
+	T* allocate(std::size_t n) {
+		++ArenaCounts::live[id];
+		++ArenaCounts::allocations[id];
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T* p, std::size_t n) {
+		--ArenaCounts::live[id];
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	friend bool operator ==(const ArenaAllocator& lhs, const ArenaAllocator& rhs) {
+		return lhs.id == rhs.id;
+	}
+};
+
+typedef MyDeque<int, ArenaAllocator<int, false> > ArenaDeque;
+typedef MyDeque<int, ArenaAllocator<int, true> > PropagatingArenaDeque;
+
+template<typename C>
+void fillArena(C& x, int n) {
+	for (int i = 0; i < n; ++i)
+		x.push_back(i);
+}
+
+TEST_F(MyDequeTest, AllocatorMapIsRebound) {
+	{
+		ArenaDeque y(ArenaAllocator<int, false>(1));
+		fillArena(y, 1000);
+		EXPECT_EQ(1, y.myMapAllocator.id);
+		// Every row holding elements and the map
+		EXPECT_EQ(static_cast<int>((y.myStart + y.mySize) / container::ROW_SIZE) + 1 + 1, ArenaCounts::live[1]);
+		EXPECT_EQ(0, ArenaCounts::live[0]);
+	}
+	EXPECT_EQ(0, ArenaCounts::live[1]);
+}
+
+TEST_F(MyDequeTest, BulkDrainAllocatesNothing) {
+	ArenaDeque y(ArenaAllocator<int, false>(1));
+	std::vector<int> out(4096);
+	fillArena(y, 4096);
+	y.drain_front(4096, out.begin());
+	const int allocations = ArenaCounts::allocations[1];
+	for (int i = 0; i < 10; ++i) {
+		fillArena(y, 4096);
+		y.drain_front(4096, out.begin());
+		fillArena(y, 4096);
+		y.pop_back(4096);
+	}
+	EXPECT_EQ(allocations, ArenaCounts::allocations[1]);
+	EXPECT_TRUE(y.empty());
+}
+
+TEST_F(MyDequeTest, ClearKeepsOneRow) {
+	{
+		ArenaDeque y(ArenaAllocator<int, false>(1));
+		fillArena(y, 1000000);
+		y.pop_front(999999);
+		const size_type mapSize = y.myMapSize;
+		const int allocations = ArenaCounts::allocations[1];
+		y.clear();
+		EXPECT_TRUE(y.empty());
+		// One row and the map
+		EXPECT_EQ(2, ArenaCounts::live[1]);
+		EXPECT_EQ(allocations, ArenaCounts::allocations[1]);
+		EXPECT_EQ(mapSize, y.myMapSize);
+
+		// Both ends reuse the map before it grows again
+		fillArena(y, 1000);
+		for (int i = 0; i < 1000; ++i)
+			y.push_front(-i);
+		EXPECT_EQ(mapSize, y.myMapSize);
+		EXPECT_EQ(-999, y.front());
+		EXPECT_EQ(999, y.back());
+	}
+	EXPECT_EQ(0, ArenaCounts::live[1]);
+}
+
+TEST_F(MyDequeTest, RowsAreAllocatedOnlyWhenReached) {
+	{
+		ArenaDeque y(ArenaAllocator<int, false>(1));
+		fillArena(y, 1000000);
+		int live = ArenaCounts::live[1];
+		// The map may grow by its spare slots, but only one row comes with it
+		fillArena(y, container::ROW_SIZE);
+		EXPECT_EQ(live + 1, ArenaCounts::live[1]);
+
+		int rows = 0;
+		for (size_type i = 0; i < y.myMapSize; ++i)
+			rows += y.myMap[i] != NULL;
+		EXPECT_EQ(rows + 1, ArenaCounts::live[1]);
+		EXPECT_LT(rows, static_cast<int>(y.myMapSize));
+	}
+	EXPECT_EQ(0, ArenaCounts::live[1]);
+}
+
+TEST_F(MyDequeTest, MoveConstructorTakesRows) {
+	container y;
+	fillArena(y, 1000);
+	const int* p = &y[0];
+	container z(std::move(y));
+	EXPECT_EQ(p, &z[0]);
+	EXPECT_EQ(1000, z.size());
+	EXPECT_TRUE(y.empty());
+	y.push_back(3);
+	EXPECT_EQ(3, y.front());
+}
+
+TEST_F(MyDequeTest, MoveConstructorWithUnequalAllocatorMovesElements) {
+	{
+		ArenaDeque y(ArenaAllocator<int, false>(1));
+		fillArena(y, 1000);
+		ArenaDeque z(std::move(y), ArenaAllocator<int, false>(2));
+		EXPECT_EQ(2, z.get_allocator().id);
+		ASSERT_EQ(1000, z.size());
+		EXPECT_EQ(999, z.back());
+		EXPECT_LT(0, ArenaCounts::live[2]);
+	}
+	EXPECT_EQ(0, ArenaCounts::live[1]);
+	EXPECT_EQ(0, ArenaCounts::live[2]);
+}
+
+TEST_F(MyDequeTest, MoveAssignEqualAllocatorsTakesRows) {
+	ArenaDeque y(ArenaAllocator<int, false>(1));
+	ArenaDeque z(ArenaAllocator<int, false>(1));
+	fillArena(y, 1000);
+	fillArena(z, 10);
+	const int* p = &y[0];
+	z = std::move(y);
+	EXPECT_EQ(p, &z[0]);
+	EXPECT_EQ(1000, z.size());
+	EXPECT_TRUE(y.empty());
+}
+
+TEST_F(MyDequeTest, MoveAssignUnequalAllocatorsMovesElements) {
+	{
+		ArenaDeque y(ArenaAllocator<int, false>(1));
+		ArenaDeque z(ArenaAllocator<int, false>(2));
+		fillArena(y, 1000);
+		const int* p = &y[0];
+		z = std::move(y);
+		EXPECT_NE(p, &z[0]);
+		EXPECT_EQ(2, z.get_allocator().id);
+		ASSERT_EQ(1000, z.size());
+		EXPECT_EQ(999, z.back());
+	}
+	EXPECT_EQ(0, ArenaCounts::live[1]);
+	EXPECT_EQ(0, ArenaCounts::live[2]);
+}
+
+TEST_F(MyDequeTest, MoveAssignPropagatingAllocatorTakesRows) {
+	{
+		PropagatingArenaDeque y(ArenaAllocator<int, true>(1));
+		PropagatingArenaDeque z(ArenaAllocator<int, true>(2));
+		fillArena(y, 1000);
+		fillArena(z, 500);
+		const int* p = &y[0];
+		z = std::move(y);
+		EXPECT_EQ(p, &z[0]);
+		EXPECT_EQ(1, z.get_allocator().id);
+		EXPECT_EQ(1, z.myMapAllocator.id);
+	}
+	EXPECT_EQ(0, ArenaCounts::live[1]);
+	EXPECT_EQ(0, ArenaCounts::live[2]);
+}
+
+TEST_F(MyDequeTest, CopyAssignPropagatingAllocator) {
+	{
+		PropagatingArenaDeque y(ArenaAllocator<int, true>(1));
+		PropagatingArenaDeque z(ArenaAllocator<int, true>(2));
+		fillArena(y, 1000);
+		fillArena(z, 500);
+		z = y;
+		EXPECT_EQ(1, z.get_allocator().id);
+		EXPECT_TRUE(y == z);
+		EXPECT_EQ(0, ArenaCounts::live[2]);
+	}
+	EXPECT_EQ(0, ArenaCounts::live[1]);
+}
+
+TEST_F(MyDequeTest, CopyAssignKeepsAllocator) {
+	ArenaDeque y(ArenaAllocator<int, false>(1));
+	ArenaDeque z(ArenaAllocator<int, false>(2));
+	fillArena(y, 1000);
+	z = y;
+	EXPECT_EQ(2, z.get_allocator().id);
+	EXPECT_TRUE(y == z);
+}
+
+TEST_F(MyDequeTest, SwapPropagatingAllocators) {
+	PropagatingArenaDeque y(ArenaAllocator<int, true>(1));
+	PropagatingArenaDeque z(ArenaAllocator<int, true>(2));
+	fillArena(y, 1000);
+	fillArena(z, 10);
+	const int* p = &y[0];
+	y.swap(z);
+	EXPECT_EQ(p, &z[0]);
+	EXPECT_EQ(1, z.get_allocator().id);
+	EXPECT_EQ(2, y.get_allocator().id);
+	EXPECT_EQ(10, y.size());
+}
+
+TEST_F(MyDequeTest, StdSwapTakesRows) {
+	container y;
+	container z;
+	fillArena(y, 1000);
+	fillArena(z, 10);
+	const int* p = &y[0];
+	std::swap(y, z);
+	EXPECT_EQ(p, &z[0]);
+	EXPECT_EQ(10, y.size());
+}
+
+TEST_F(MyDequeTest, SmallBufferMoveStaysInline) {
+	typedef MyDeque<int, ArenaAllocator<int, false>, true> SmallArenaDeque;
+	const int allocations = ArenaCounts::allocations[1];
+	SmallArenaDeque y(ArenaAllocator<int, false>(1));
+	fillArena(y, 10);
+	SmallArenaDeque z(std::move(y));
+	ASSERT_EQ(10, z.size());
+	EXPECT_EQ(9, z.back());
+	EXPECT_TRUE(y.empty());
+	EXPECT_TRUE(y.mySmallBuffer.ownsMap(y.myMap));
+	EXPECT_TRUE(z.mySmallBuffer.ownsMap(z.myMap));
+	EXPECT_TRUE(z.mySmallBuffer.ownsRow(*z.myMap));
+
+	y.push_back(3);
+	std::swap(y, z);
+	ASSERT_EQ(10, y.size());
+	EXPECT_EQ(9, y.back());
+	ASSERT_EQ(1, z.size());
+	EXPECT_EQ(3, z.front());
+	EXPECT_EQ(allocations, ArenaCounts::allocations[1]);
+}
+
+TEST_F(MyDequeTest, SmallBufferMoveTakesHeapRows) {
+	typedef MyDeque<int, ArenaAllocator<int, true>, true> SmallArenaDeque;
+	{
+		SmallArenaDeque y(ArenaAllocator<int, true>(1));
+		fillArena(y, 1000);
+		const int* p = &y[500];
+		const int allocations = ArenaCounts::allocations[1];
+		SmallArenaDeque z(std::move(y));
+		EXPECT_EQ(allocations, ArenaCounts::allocations[1]);
+		EXPECT_EQ(p, &z[500]);
+		ASSERT_EQ(1000, z.size());
+		for (int i = 0; i < 1000; ++i)
+			ASSERT_EQ(i, z[i]);
+		EXPECT_TRUE(y.empty());
+		EXPECT_TRUE(y.mySmallBuffer.ownsMap(y.myMap));
+
+		// Taking an inline deque gives z's rows back to the allocator
+		SmallArenaDeque w(ArenaAllocator<int, true>(2));
+		fillArena(w, 10);
+		z = std::move(w);
+		ASSERT_EQ(10, z.size());
+		EXPECT_EQ(2, z.get_allocator().id);
+		EXPECT_EQ(0, ArenaCounts::live[1]);
+		EXPECT_EQ(0, ArenaCounts::live[2]);
+	}
+	EXPECT_EQ(0, ArenaCounts::live[1]);
+}
+
+#if __cplusplus >= 201703L
+TEST_F(MyDequeTest, PmrMonotonicResource) {
+	// Anything that missed the buffer would hit null_memory_resource and throw
+	char buffer[1 << 16];
+	std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+	MyDeque<int, std::pmr::polymorphic_allocator<int> > y(&resource);
+	fillArena(y, 5000);
+	y.pop_front(4000);
+	EXPECT_EQ(4000, y.front());
+	EXPECT_EQ(&resource, y.get_allocator().resource());
+}
+
+TEST_F(MyDequeTest, PmrElementsShareTheResource) {
+	std::pmr::monotonic_buffer_resource resource;
+	MyDeque<std::pmr::string, std::pmr::polymorphic_allocator<std::pmr::string> > y(&resource);
+	y.push_back(std::pmr::string(100, 'a'));
+	y.push_front(std::pmr::string(100, 'b'));
+	EXPECT_EQ(&resource, y.front().get_allocator().resource());
+	EXPECT_EQ(&resource, y.back().get_allocator().resource());
+}
+
+TEST_F(MyDequeTest, PmrCopyUsesDefaultResource) {
+	std::pmr::monotonic_buffer_resource resource;
+	MyDeque<int, std::pmr::polymorphic_allocator<int> > y(&resource);
+	fillArena(y, 100);
+	MyDeque<int, std::pmr::polymorphic_allocator<int> > z(y);
+	EXPECT_EQ(std::pmr::get_default_resource(), z.get_allocator().resource());
+	EXPECT_TRUE(y == z);
+}
+
+TEST_F(MyDequeTest, PmrMoveAndSwapSameResource) {
+	std::pmr::unsynchronized_pool_resource resource;
+	MyDeque<int, std::pmr::polymorphic_allocator<int> > y(&resource);
+	MyDeque<int, std::pmr::polymorphic_allocator<int> > z(&resource);
+	fillArena(y, 1000);
+	const int* p = &y[0];
+	z = std::move(y);
+	EXPECT_EQ(p, &z[0]);
+	y.swap(z);
+	EXPECT_EQ(p, &y[0]);
+}
+
+TEST_F(MyDequeTest, PmrMoveAssignAcrossResources) {
+	std::pmr::unsynchronized_pool_resource first;
+	std::pmr::unsynchronized_pool_resource second;
+	MyDeque<int, std::pmr::polymorphic_allocator<int> > y(&first);
+	MyDeque<int, std::pmr::polymorphic_allocator<int> > z(&second);
+	fillArena(y, 1000);
+	z = std::move(y);
+	EXPECT_EQ(&second, z.get_allocator().resource());
+	ASSERT_EQ(1000, z.size());
+	EXPECT_EQ(999, z.back());
+}
+#endif
+
+// --- hardening checks ---
+
+#if MYDEQUE_HARDENING >= 1
+TEST_F(MyDequeTest, CheckIndexPastEnd) {
+	x.push_back(1);
+	EXPECT_DEATH(x[1], "MyDeque check failed");
+}
+
+TEST_F(MyDequeTest, CheckPopEmpty) {
+	EXPECT_DEATH(x.pop_front(), "MyDeque check failed");
+	EXPECT_DEATH(x.pop_back(), "MyDeque check failed");
+	EXPECT_DEATH(x.pop_back(1), "MyDeque check failed");
+}
+
+TEST_F(MyDequeTest, CheckSwapUnequalAllocators) {
+	ArenaDeque y(ArenaAllocator<int, false>(1));
+	ArenaDeque z(ArenaAllocator<int, false>(2));
+	EXPECT_DEATH(y.swap(z), "MyDeque check failed");
+}
+#endif
@@ -0,0 +1,306 @@
+/*
+ * TestDequeTrace
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++0x -Wall TestDequeTrace.c++ -g -o TestDequeTrace -lgtest -lgtest_main -lpthread
+ *
+ * Then it can run with
+ * TestDequeTrace
+ */
+
+#include <cstddef>   // size_t
+#include <deque>     // deque
+#include <sstream>   // stringstream
+#include <stdexcept> // runtime_error
+#include <string>    // string
+#include <utility>   // move
+#include <vector>    // vector
+
+#include "gtest/gtest.h" // Google Test framework
+
+#include "DequeTestSupport.h"
+#include "DequeTrace.h"
+
+namespace {
+	std::vector<DequeTraceRecord> readAll(std::stringstream& s) {
+		DequeTraceReader reader(s);
+		std::vector<DequeTraceRecord> records;
+		DequeTraceRecord r;
+		while (reader.next(r))
+			records.push_back(r);
+		return records;
+	}
+
+	/**
+	 * Replay every record against c, returning the checksum
+	 */
+	template<typename C>
+	std::size_t replayAll(C& c, const std::vector<DequeTraceRecord>& records) {
+		std::size_t counter = 0;
+		std::size_t checksum = 0;
+		for (std::size_t i = 0; i < records.size(); ++i)
+			checksum += replay_record(c, records[i], counter);
+		return checksum;
+	}
+}
+
+// --- format ---
+
+TEST(DequeTraceTest, EmptyTrace) {
+	std::stringstream s;
+	{
+		DequeTraceWriter trace(s, 8);
+	}
+	DequeTraceReader reader(s);
+	EXPECT_EQ(8, reader.elementSize());
+	DequeTraceRecord r;
+	EXPECT_FALSE(reader.next(r));
+}
+
+TEST(DequeTraceTest, RoundTrip) {
+	std::stringstream s;
+	{
+		DequeTraceWriter trace(s, 4);
+		trace.phase("start");
+		trace.bare(TRACE_PUSH_BACK);
+		trace.bare(TRACE_PUSH_BACK);
+		trace.bare(TRACE_PUSH_BACK);
+		trace.bare(TRACE_POP_FRONT);
+		trace.withArgument(TRACE_INDEX, 300);
+		trace.withArgument(TRACE_RESIZE, 1UL << 40);
+		trace.bare(TRACE_CLEAR);
+	}
+
+	std::vector<DequeTraceRecord> records = readAll(s);
+	ASSERT_EQ(6, records.size());
+	EXPECT_EQ(TRACE_PHASE, records[0].op);
+	EXPECT_EQ("start", records[0].phase);
+	EXPECT_EQ(TRACE_PUSH_BACK, records[1].op);
+	EXPECT_EQ(3, records[1].count);
+	EXPECT_EQ(TRACE_POP_FRONT, records[2].op);
+	EXPECT_EQ(1, records[2].count);
+	EXPECT_EQ(TRACE_INDEX, records[3].op);
+	EXPECT_EQ(300, records[3].argument);
+	EXPECT_EQ(TRACE_RESIZE, records[4].op);
+	EXPECT_EQ(1UL << 40, records[4].argument);
+	EXPECT_EQ(TRACE_CLEAR, records[5].op);
+}
+
+TEST(DequeTraceTest, RunsAreCompact) {
+	std::stringstream s;
+	{
+		DequeTraceWriter trace(s, 8);
+		for (int i = 0; i < 1000000; ++i)
+			trace.bare(TRACE_PUSH_BACK);
+	}
+	// The header, then the run: one op byte and a three byte count
+	EXPECT_EQ(6 + 4, s.str().size());
+}
+
+TEST(DequeTraceTest, BadMagicThrows) {
+	std::stringstream s("MDQX\x01\x08");
+	EXPECT_THROW(DequeTraceReader reader(s), std::runtime_error);
+}
+
+TEST(DequeTraceTest, TruncatedTraceThrows) {
+	std::stringstream s;
+	{
+		DequeTraceWriter trace(s, 8);
+		trace.withArgument(TRACE_INDEX, 1000);
+	}
+	std::string bytes = s.str();
+	std::stringstream truncated(bytes.substr(0, bytes.size() - 1));
+	DequeTraceReader reader(truncated);
+	DequeTraceRecord r;
+	EXPECT_THROW(reader.next(r), std::runtime_error);
+}
+
+TEST(DequeTraceTest, UnknownOpThrows) {
+	std::stringstream s;
+	{
+		DequeTraceWriter trace(s, 8);
+	}
+	s.seekp(0, std::ios::end);
+	s.put(static_cast<char>(TRACE_OP_COUNT));
+	DequeTraceReader reader(s);
+	DequeTraceRecord r;
+	EXPECT_THROW(reader.next(r), std::runtime_error);
+}
+
+// --- recording ---
+
+TEST(DequeTraceTest, RecordingForwards) {
+	std::stringstream s;
+	DequeTraceWriter trace(s, sizeof(int));
+	RecordingDeque<int> x(trace);
+	x.push_back(2);
+	x.push_front(1);
+	x.push_back(3);
+	x.insert(x.begin() + 1, 9);
+	ASSERT_EQ(4, x.size());
+	EXPECT_EQ(1, x[0]);
+	EXPECT_EQ(9, x[1]);
+	EXPECT_EQ(3, x.back());
+	x.erase(x.begin() + 1);
+	x.pop_front();
+	EXPECT_EQ(2, x.front());
+	x.resize(5, 7);
+	EXPECT_EQ(7, x.deque()[4]);
+	x.pop_back(2);
+	EXPECT_EQ(3, x.size());
+	x.clear();
+	EXPECT_TRUE(x.empty());
+}
+
+TEST(DequeTraceTest, RecordsOperations) {
+	std::stringstream s;
+	{
+		DequeTraceWriter trace(s, sizeof(int));
+		RecordingDeque<int> x(trace);
+		x.push_back(1);
+		x.push_back(2);
+		x.insert(x.begin() + 1, 9);
+		x.pop_front(2);
+		x.erase(x.begin());
+	}
+
+	std::vector<DequeTraceRecord> records = readAll(s);
+	ASSERT_EQ(4, records.size());
+	EXPECT_EQ(TRACE_PUSH_BACK, records[0].op);
+	EXPECT_EQ(2, records[0].count);
+	EXPECT_EQ(TRACE_INSERT, records[1].op);
+	EXPECT_EQ(1, records[1].argument);
+	EXPECT_EQ(TRACE_POP_FRONT_N, records[2].op);
+	EXPECT_EQ(2, records[2].argument);
+	EXPECT_EQ(TRACE_ERASE, records[3].op);
+	EXPECT_EQ(0, records[3].argument);
+}
+
+// --- replay ---
+
+TEST(DequeTraceTest, ReplayMatchesStdDeque) {
+	std::stringstream s;
+	{
+		DequeTraceWriter trace(s, sizeof(long));
+		RecordingDeque<long> x(trace);
+		Samples samples(1);
+		for (long i = 0; i < 5000; ++i) {
+			unsigned long state = samples.bits();
+			switch ((state >> 33) % 8) {
+				case 0: case 1:
+					x.push_back(i);
+					break;
+				case 2: case 3:
+					x.push_front(i);
+					break;
+				case 4:
+					if (!x.empty())
+						x.pop_back();
+					break;
+				case 5:
+					if (!x.empty())
+						x.pop_front();
+					break;
+				case 6:
+					x.insert(x.begin() + (state >> 40) % (x.size() + 1), i);
+					break;
+				default:
+					if (!x.empty())
+						x.erase(x.begin() + (state >> 40) % x.size());
+					break;
+			}
+			if (!x.empty())
+				x[(state >> 20) % x.size()];
+		}
+	}
+
+	std::vector<DequeTraceRecord> records = readAll(s);
+	MyDeque<long> mine;
+	std::deque<long> theirs;
+	EXPECT_EQ(replayAll(theirs, records), replayAll(mine, records));
+	ASSERT_EQ(theirs.size(), mine.size());
+	for (std::size_t i = 0; i < theirs.size(); ++i)
+		ASSERT_EQ(theirs[i], mine[i]);
+}
+
+TEST(DequeTraceTest, ReplayBulkPops) {
+	std::stringstream s;
+	{
+		DequeTraceWriter trace(s, sizeof(long));
+		RecordingDeque<long> x(trace);
+		for (long i = 0; i < 1000; ++i)
+			x.push_back(i);
+		x.pop_front(300);
+		x.pop_back(200);
+		x.pop_front(1);
+	}
+
+	std::vector<DequeTraceRecord> records = readAll(s);
+	MyDeque<long> mine;
+	std::deque<long> theirs;
+	EXPECT_EQ(replayAll(theirs, records), replayAll(mine, records));
+	ASSERT_EQ(499, mine.size());
+	ASSERT_EQ(499, theirs.size());
+	EXPECT_EQ(301, mine.front());
+	EXPECT_EQ(301, theirs.front());
+	EXPECT_EQ(799, mine.back());
+	EXPECT_EQ(799, theirs.back());
+}
+
+TEST(DequeTraceTest, RecordsBatchOperations) {
+	std::stringstream s;
+	std::vector<int> in(300, 5);
+	std::vector<int> out(100);
+	{
+		DequeTraceWriter trace(s, sizeof(int));
+		RecordingDeque<int> x(trace);
+		x.append(in.begin(), in.end());
+		x.prepend(&in[0], 20);
+		x.drain_front(out.size(), out.begin());
+		int v = 4;
+		x.push_back(std::move(v));
+		x.assign(3, 7);
+		EXPECT_EQ(3, x.size());
+		EXPECT_EQ(7, x.deque()[2]);
+	}
+
+	std::vector<DequeTraceRecord> records = readAll(s);
+	ASSERT_EQ(5, records.size());
+	EXPECT_EQ(TRACE_APPEND, records[0].op);
+	EXPECT_EQ(300, records[0].argument);
+	EXPECT_EQ(TRACE_PREPEND, records[1].op);
+	EXPECT_EQ(20, records[1].argument);
+	EXPECT_EQ(TRACE_DRAIN_FRONT, records[2].op);
+	EXPECT_EQ(100, records[2].argument);
+	EXPECT_EQ(TRACE_PUSH_BACK, records[3].op);
+	EXPECT_EQ(1, records[3].count);
+	EXPECT_EQ(TRACE_ASSIGN, records[4].op);
+	EXPECT_EQ(3, records[4].argument);
+}
+
+TEST(DequeTraceTest, ReplayBatchOperations) {
+	std::stringstream s;
+	{
+		DequeTraceWriter trace(s, sizeof(long));
+		RecordingDeque<long> x(trace);
+		std::vector<long> in(1000, 1);
+		std::vector<long> out(700);
+		x.append(in.begin(), in.end());
+		x.prepend(&in[0], 500);
+		x.drain_front(out.size(), out.begin());
+		x.push_back(2);
+		x.assign(&in[0], 200);
+		x.append(&in[0], 50);
+		x.prepend(in.begin(), in.begin() + 30);
+		x.drain_front(10, out.begin());
+	}
+
+	std::vector<DequeTraceRecord> records = readAll(s);
+	MyDeque<long> mine;
+	std::deque<long> theirs;
+	EXPECT_EQ(replayAll(theirs, records), replayAll(mine, records));
+	ASSERT_EQ(270, mine.size());
+	ASSERT_EQ(theirs.size(), mine.size());
+	for (std::size_t i = 0; i < theirs.size(); ++i)
+		ASSERT_EQ(theirs[i], mine[i]);
+}
@@ -0,0 +1,184 @@
+/*
+ * TestSlidingWindow
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++0x -Wall TestSlidingWindow.c++ -o TestSlidingWindow -lgtest -lgtest_main -lpthread
+ *
+ * Then it can run with
+ * TestSlidingWindow
+ */
+
+#include <algorithm> // max, max_element, min, min_element
+#include <deque>     // deque
+#include <numeric>   // accumulate
+#include <string>    // string
+#include <utility>   // make_pair, pair
+
+#include "gtest/gtest.h" // Google Test framework
+
+#include "DequeTestSupport.h"
+#include "SlidingWindow.h"
+
+// Each window's aggregates are recomputed from scratch after every step
+
+// --- WindowAggregate ---
+
+TEST(WindowAggregateTest, Empty) {
+	WindowAggregate<int> w;
+	EXPECT_TRUE(w.empty());
+	EXPECT_EQ(0, w.size());
+}
+
+TEST(WindowAggregateTest, SumMatchesRecompute) {
+	WindowAggregate<long> w;
+	std::deque<long> expected;
+	Samples samples(1);
+
+	for (int i = 0; i < 20000; ++i) {
+		if (expected.empty() || samples.next(3) != 0) {
+			long v = samples.next(1000) - 500;
+			w.push_back(v);
+			expected.push_back(v);
+		}
+		else {
+			w.pop_front();
+			expected.pop_front();
+		}
+		ASSERT_EQ(expected.size(), w.size());
+		if (!expected.empty()) {
+			ASSERT_EQ(std::accumulate(expected.begin(), expected.end(), 0L), w.aggregate());
+		}
+	}
+}
+
+TEST(WindowAggregateTest, KeepsOrderForNonCommutativeOp) {
+	WindowAggregate<std::string> w;
+	std::string expected;
+
+	for (int i = 0; i < 300; ++i) {
+		std::string v(1, 'a' + i % 26);
+		w.push_back(v);
+		expected += v;
+		if (i % 3 == 2) {
+			w.pop_front();
+			expected.erase(0, 1);
+		}
+		ASSERT_EQ(expected, w.aggregate());
+	}
+}
+
+TEST(WindowAggregateTest, Clear) {
+	WindowAggregate<int> w;
+	for (int i = 0; i < 500; ++i)
+		w.push_back(i);
+	w.pop_front();
+	w.clear();
+	EXPECT_TRUE(w.empty());
+	w.push_back(7);
+	EXPECT_EQ(7, w.aggregate());
+}
+
+// --- MonotonicWindow ---
+
+TEST(MonotonicWindowTest, MinAndMaxMatchRecompute) {
+	MonotonicWindow<int> lo;
+	MonotonicWindow<int, std::greater<int> > hi;
+	std::deque<int> expected;
+	Samples samples(2);
+
+	for (int i = 0; i < 20000; ++i) {
+		// Few distinct values, so ties get exercised
+		int v = samples.next(20);
+		lo.push_back(v);
+		hi.push_back(v);
+		expected.push_back(v);
+		if (expected.size() > 37) {
+			lo.pop_front();
+			hi.pop_front();
+			expected.pop_front();
+		}
+		ASSERT_EQ(expected.size(), lo.size());
+		ASSERT_EQ(*std::min_element(expected.begin(), expected.end()), lo.extreme());
+		ASSERT_EQ(*std::max_element(expected.begin(), expected.end()), hi.extreme());
+	}
+}
+
+TEST(MonotonicWindowTest, DrainToEmpty) {
+	MonotonicWindow<int> lo;
+	for (int i = 10; i > 0; --i)
+		lo.push_back(i);
+	for (int i = 10; i > 1; --i) {
+		lo.pop_front();
+		EXPECT_EQ(1, lo.extreme());
+	}
+	lo.pop_front();
+	EXPECT_TRUE(lo.empty());
+	lo.push_back(5);
+	EXPECT_EQ(5, lo.extreme());
+}
+
+// --- RollingStats ---
+
+TEST(RollingStatsTest, CountWindow) {
+	RollingStats<long> stats(100);
+	std::deque<long> expected;
+	Samples samples(3);
+
+	for (long t = 0; t < 5000; ++t) {
+		long v = samples.next(10000);
+		stats.push(t, v);
+		expected.push_back(v);
+		if (expected.size() > 100)
+			expected.pop_front();
+
+		ASSERT_EQ(expected.size(), stats.size());
+		ASSERT_EQ(std::accumulate(expected.begin(), expected.end(), 0L), stats.sum());
+		ASSERT_EQ(*std::min_element(expected.begin(), expected.end()), stats.min());
+		ASSERT_EQ(*std::max_element(expected.begin(), expected.end()), stats.max());
+	}
+}
+
+TEST(RollingStatsTest, TimeWindow) {
+	RollingStats<int> stats(static_cast<RollingStats<int>::size_type>(-1), 50);
+	std::deque<std::pair<long long, int> > expected;
+	Samples samples(4);
+
+	long long t = 0;
+	for (int i = 0; i < 5000; ++i) {
+		t += samples.next(4);
+		int v = samples.next(1000);
+		stats.push(t, v);
+		expected.push_back(std::make_pair(t, v));
+		while (t - expected.front().first >= 50)
+			expected.pop_front();
+
+		ASSERT_EQ(expected.size(), stats.size());
+		ASSERT_EQ(expected.front().first, stats.oldest());
+		int sum = 0;
+		int lo = expected.front().second;
+		int hi = expected.front().second;
+		for (std::deque<std::pair<long long, int> >::iterator j = expected.begin(); j != expected.end(); ++j) {
+			sum += j->second;
+			lo = std::min(lo, j->second);
+			hi = std::max(hi, j->second);
+		}
+		ASSERT_EQ(sum, stats.sum());
+		ASSERT_EQ(lo, stats.min());
+		ASSERT_EQ(hi, stats.max());
+	}
+}
+
+TEST(RollingStatsTest, AdvanceEvictsWithoutSamples) {
+	RollingStats<double> stats(1000, 10);
+	stats.push(0, 1.5);
+	stats.push(5, 2.5);
+	EXPECT_EQ(2, stats.size());
+	EXPECT_DOUBLE_EQ(4.0, stats.sum());
+
+	stats.advance(12);
+	EXPECT_EQ(1, stats.size());
+	EXPECT_DOUBLE_EQ(2.5, stats.min());
+
+	stats.advance(15);
+	EXPECT_TRUE(stats.empty());
+}
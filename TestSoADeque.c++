@@ -0,0 +1,407 @@
+/*
+ * TestSoADeque
+ *
+ * To compile this, use the command
+ * g++ -pedantic -std=c++0x -Wall TestSoADeque.c++ -o TestSoADeque -lgtest -lgtest_main -lpthread
+ *
+ * Then it can run with
+ * TestSoADeque
+ */
+
+#include <cstddef>     // size_t
+#include <deque>       // deque
+#include <memory>      // allocator
+#include <new>         // bad_alloc
+#include <stdexcept>   // out_of_range
+#include <tuple>       // get, make_tuple, tuple
+#include <type_traits> // integral_constant
+#include <utility>     // move
+
+#include "gtest/gtest.h" // Google Test framework
+
+#include "DequeTestSupport.h"
+#include "SoADeque.h"
+
+namespace {
+	typedef std::tuple<long long, double, int> Trade;
+	typedef SoADeque<Trade> Trades;
+
+	Trade trade(int i) {
+		return std::make_tuple(1000LL * i, i * 0.5, i % 7);
+	}
+}
+
+TEST(SoADequeTest, Empty) {
+	Trades x;
+	EXPECT_TRUE(x.empty());
+	EXPECT_EQ(0, x.size());
+	EXPECT_TRUE(x.begin() == x.end());
+	EXPECT_EQ(0, x.column<0>().segments());
+}
+
+TEST(SoADequeTest, PushAndPopMatchStdDeque) {
+	Trades x;
+	std::deque<Trade> expected;
+	Samples samples(1);
+
+	for (int i = 0; i < 20000; ++i) {
+		switch (expected.empty() ? samples.next(2) : samples.next(4)) {
+			case 0:
+				x.push_back(trade(i));
+				expected.push_back(trade(i));
+				break;
+			case 1:
+				x.push_front(trade(i));
+				expected.push_front(trade(i));
+				break;
+			case 2:
+				x.pop_back();
+				expected.pop_back();
+				break;
+			default:
+				x.pop_front();
+				expected.pop_front();
+		}
+		ASSERT_EQ(expected.size(), x.size());
+		if (!expected.empty()) {
+			ASSERT_EQ(expected.front(), static_cast<Trade>(x.front()));
+			ASSERT_EQ(expected.back(), static_cast<Trade>(x.back()));
+		}
+	}
+
+	for (std::size_t i = 0; i < expected.size(); ++i)
+		ASSERT_EQ(expected[i], static_cast<Trade>(x[i]));
+}
+
+TEST(SoADequeTest, ReferenceReadsAndWritesFields) {
+	Trades x;
+	x.push_back(trade(1));
+	x.push_back(trade(2));
+
+	x[0].get<1>() = 9.25;
+	EXPECT_EQ(1000LL, x[0].get<0>());
+	EXPECT_DOUBLE_EQ(9.25, x[0].get<1>());
+
+	x[1] = std::make_tuple(5LL, 6.0, 7);
+	EXPECT_TRUE(x[1] == std::make_tuple(5LL, 6.0, 7));
+
+	x[0] = x[1];
+	EXPECT_TRUE(x[0] == std::make_tuple(5LL, 6.0, 7));
+
+	x[1] = trade(3);
+	swap(x[0], x[1]);
+	EXPECT_TRUE(x[0] == trade(3));
+	EXPECT_TRUE(x[1] == std::make_tuple(5LL, 6.0, 7));
+}
+
+TEST(SoADequeTest, IteratorsCrossRows) {
+	Trades x;
+	for (int i = 0; i < 1000; ++i)
+		x.push_front(trade(999 - i));
+
+	int i = 0;
+	for (Trades::iterator j = x.begin(); j != x.end(); ++j, ++i)
+		ASSERT_TRUE(*j == trade(i));
+	EXPECT_EQ(1000, i);
+
+	for (Trades::iterator j = x.end(); j != x.begin(); ) {
+		--j;
+		--i;
+		ASSERT_TRUE(*j == trade(i));
+	}
+
+	Trades::iterator j = x.begin();
+	j += 700;
+	EXPECT_TRUE(*j == trade(700));
+	j -= 650;
+	EXPECT_TRUE(*j == trade(50));
+	EXPECT_TRUE(*(j + 300) == trade(350));
+	EXPECT_TRUE(x.begin() < j);
+
+	(*j).get<2>() = 42;
+	const Trades& y = x;
+	Trades::const_iterator k = y.begin() + 50;
+	EXPECT_EQ(42, (*k).get<2>());
+}
+
+TEST(SoADequeTest, ColumnSegmentsCoverEveryElement) {
+	Trades x;
+	// Start partway into a row, so the first and last spans are partial
+	for (int i = 0; i < 3; ++i)
+		x.push_front(trade(-1 - i));
+	for (int i = 0; i < 1000; ++i)
+		x.push_back(trade(i));
+
+	Trades::column_view<int, 2> qty = x.column<2>();
+	EXPECT_EQ(x.size(), qty.size());
+
+	std::size_t n = 0;
+	std::size_t segments = 0;
+	for (Trades::column_view<int, 2>::segment_iterator s = qty.begin(); s != qty.end(); ++s) {
+		for (std::size_t i = 0; i < (*s).size(); ++i)
+			ASSERT_EQ(std::get<2>(static_cast<Trade>(x[n + i])), (*s)[i]);
+		n += (*s).size();
+		++segments;
+	}
+	EXPECT_EQ(x.size(), n);
+	EXPECT_EQ(qty.segments(), segments);
+	EXPECT_LT(1, segments);
+
+	for (std::size_t i = 0; i < x.size(); ++i)
+		ASSERT_EQ(&x[i].get<2>(), &qty[i]);
+}
+
+TEST(SoADequeTest, ColumnReductionMatchesElements) {
+	Trades x;
+	double expected = 0;
+	for (int i = 0; i < 5000; ++i) {
+		x.push_back(trade(i));
+		expected += i * 0.5;
+	}
+
+	const Trades& y = x;
+	double sum = 0;
+	for (SoASpan<const double> s : y.column<1>())
+		for (const double* p = s.begin(); p != s.end(); ++p)
+			sum += *p;
+	EXPECT_DOUBLE_EQ(expected, sum);
+
+	for (SoASpan<double> s : x.column<1>())
+		for (std::size_t i = 0; i < s.size(); ++i)
+			s[i] *= 2;
+	EXPECT_DOUBLE_EQ(2 * 4999 * 0.5, x.back().get<1>());
+}
+
+TEST(SoADequeTest, CopyAndAssignAreIndependent) {
+	Trades x;
+	for (int i = 0; i < 300; ++i)
+		x.push_back(trade(i));
+
+	Trades y = x;
+	y[0].get<0>() = -1;
+	EXPECT_EQ(0, x[0].get<0>());
+	EXPECT_EQ(-1, y[0].get<0>());
+
+	Trades z;
+	z.push_back(trade(5));
+	z = x;
+	ASSERT_EQ(300, z.size());
+	for (int i = 0; i < 300; ++i)
+		ASSERT_TRUE(z[i] == trade(i));
+}
+
+TEST(SoADequeTest, CopyAfterClear) {
+	// Clearing leaves empty slots and rows scattered through the map
+	Trades x;
+	for (int i = 0; i < 2000; ++i)
+		x.push_front(trade(i));
+	x.clear();
+	for (int i = 0; i < 300; ++i) {
+		x.push_back(trade(i));
+		x.push_front(trade(-i));
+	}
+
+	Trades y = x;
+	ASSERT_EQ(600, y.size());
+	for (int i = 0; i < 300; ++i) {
+		ASSERT_TRUE(y[299 - i] == trade(-i));
+		ASSERT_TRUE(y[300 + i] == trade(i));
+	}
+	y.push_back(trade(7));
+	EXPECT_TRUE(y.back() == trade(7));
+	EXPECT_EQ(600, x.size());
+}
+
+TEST(SoADequeTest, AtThrows) {
+	Trades x(3, trade(4));
+	EXPECT_TRUE(x.at(2) == trade(4));
+	EXPECT_THROW(x.at(3), std::out_of_range);
+}
+
+TEST(SoADequeTest, ClearThenReuse) {
+	Trades x;
+	for (int i = 0; i < 1000; ++i)
+		x.push_back(trade(i));
+	x.clear();
+	EXPECT_TRUE(x.empty());
+	EXPECT_EQ(0, x.column<1>().segments());
+	x.push_front(trade(1));
+	x.push_back(trade(2));
+	EXPECT_TRUE(x.front() == trade(1));
+	EXPECT_TRUE(x.back() == trade(2));
+}
+
+TEST(SoADequeTest, QueueReusesRows) {
+	Trades x;
+	for (int i = 0; i < 100000; ++i) {
+		x.push_back(trade(i));
+		if (x.size() > 500)
+			x.pop_front();
+	}
+	ASSERT_EQ(500, x.size());
+	for (int i = 0; i < 500; ++i)
+		ASSERT_TRUE(x[i] == trade(99500 + i));
+}
+
+// --- allocators ---
+
+namespace {
+	/**
+	 * What every TaggedAllocator has allocated, and how many more
+	 * allocations it grants before throwing (unlimited when negative)
+	 */
+	struct TaggedCounts {
+		static int live;
+		static int allocations;
+		static int budget;
+	};
+
+	int TaggedCounts::live = 0;
+	int TaggedCounts::allocations = 0;
+	int TaggedCounts::budget = -1;
+
+	/**
+	 * A stateful allocator tagged with an id, with all three
+	 * propagate_on_container_* flags set to Propagate
+	 * Copy construction hands the copy id + 10, so it shows up in tests
+	 */
+	template<typename T, bool Propagate>
+	struct TaggedAllocator {
+		typedef T value_type;
+		typedef std::integral_constant<bool, Propagate> propagate_on_container_copy_assignment;
+		typedef std::integral_constant<bool, Propagate> propagate_on_container_move_assignment;
+		typedef std::integral_constant<bool, Propagate> propagate_on_container_swap;
+
+		template<typename U>
+		struct rebind {
+			typedef TaggedAllocator<U, Propagate> other;
+		};
+
+		int id;
+
+		explicit TaggedAllocator(int i) : id(i) {}
+
+		template<typename U>
+		TaggedAllocator(const TaggedAllocator<U, Propagate>& that) : id(that.id) {}
+
+		TaggedAllocator select_on_container_copy_construction() const {
+			return TaggedAllocator(id + 10);
+		}
+
+		T* allocate(std::size_t n) {
+			if (TaggedCounts::budget == 0)
+				throw std::bad_alloc();
+			if (TaggedCounts::budget > 0)
+				--TaggedCounts::budget;
+			++TaggedCounts::live;
+			++TaggedCounts::allocations;
+			return std::allocator<T>().allocate(n);
+		}
+
+		void deallocate(T* p, std::size_t n) {
+			--TaggedCounts::live;
+			std::allocator<T>().deallocate(p, n);
+		}
+
+		friend bool operator ==(const TaggedAllocator& lhs, const TaggedAllocator& rhs) {
+			return lhs.id == rhs.id;
+		}
+	};
+
+	typedef SoADeque<Trade, TaggedAllocator<Trade, false> > TaggedTrades;
+	typedef SoADeque<Trade, TaggedAllocator<Trade, true> > PropagatingTrades;
+
+	template<typename C>
+	void fillTrades(C& x, int n) {
+		for (int i = 0; i < n; ++i)
+			x.push_back(trade(i));
+	}
+}
+
+TEST(SoADequeTest, CopyConstructorSelectsAllocator) {
+	TaggedTrades x(TaggedAllocator<Trade, false>(1));
+	fillTrades(x, 300);
+	TaggedTrades y = x;
+	EXPECT_EQ(11, y.get_allocator().id);
+	ASSERT_EQ(300, y.size());
+	EXPECT_TRUE(y[299] == trade(299));
+}
+
+TEST(SoADequeTest, CopyOfDrainedDequeLeavesSpareRows) {
+	TaggedTrades x(TaggedAllocator<Trade, false>(1));
+	fillTrades(x, 100000);
+	while (!x.empty())
+		x.pop_front();
+
+	// The map and the one row the empty copy needs
+	int before = TaggedCounts::allocations;
+	TaggedTrades y = x;
+	EXPECT_EQ(before + 2, TaggedCounts::allocations);
+	fillTrades(y, 300);
+	EXPECT_TRUE(y[299] == trade(299));
+}
+
+TEST(SoADequeTest, CopyThatThrowsFreesEverything) {
+	TaggedTrades x(TaggedAllocator<Trade, false>(1));
+	fillTrades(x, 1000);
+
+	int live = TaggedCounts::live;
+	TaggedCounts::budget = 4;
+	EXPECT_THROW(TaggedTrades y(x), std::bad_alloc);
+	TaggedCounts::budget = -1;
+	EXPECT_EQ(live, TaggedCounts::live);
+}
+
+TEST(SoADequeTest, CopyAssignKeepsAllocator) {
+	TaggedTrades x(TaggedAllocator<Trade, false>(1));
+	TaggedTrades y(TaggedAllocator<Trade, false>(2));
+	fillTrades(x, 300);
+	y = x;
+	EXPECT_EQ(2, y.get_allocator().id);
+	ASSERT_EQ(300, y.size());
+	EXPECT_TRUE(y[299] == trade(299));
+}
+
+TEST(SoADequeTest, CopyAssignPropagatingAllocator) {
+	PropagatingTrades x(TaggedAllocator<Trade, true>(1));
+	PropagatingTrades y(TaggedAllocator<Trade, true>(2));
+	fillTrades(x, 300);
+	y = x;
+	EXPECT_EQ(1, y.get_allocator().id);
+	ASSERT_EQ(300, y.size());
+	EXPECT_TRUE(y[299] == trade(299));
+}
+
+TEST(SoADequeTest, MoveAssignKeepsUnequalAllocator) {
+	TaggedTrades x(TaggedAllocator<Trade, false>(1));
+	TaggedTrades y(TaggedAllocator<Trade, false>(2));
+	fillTrades(x, 300);
+	y = std::move(x);
+	EXPECT_EQ(2, y.get_allocator().id);
+	EXPECT_EQ(1, x.get_allocator().id);
+	ASSERT_EQ(300, y.size());
+	EXPECT_TRUE(y[299] == trade(299));
+}
+
+TEST(SoADequeTest, MoveAssignPropagatingAllocatorTakesRows) {
+	PropagatingTrades x(TaggedAllocator<Trade, true>(1));
+	PropagatingTrades y(TaggedAllocator<Trade, true>(2));
+	fillTrades(x, 300);
+	y = std::move(x);
+	EXPECT_EQ(1, y.get_allocator().id);
+	EXPECT_TRUE(x.empty());
+	ASSERT_EQ(300, y.size());
+	EXPECT_TRUE(y[299] == trade(299));
+}
+
+TEST(SoADequeTest, SwapPropagatingAllocators) {
+	PropagatingTrades x(TaggedAllocator<Trade, true>(1));
+	PropagatingTrades y(TaggedAllocator<Trade, true>(2));
+	fillTrades(x, 300);
+	fillTrades(y, 10);
+	x.swap(y);
+	EXPECT_EQ(2, x.get_allocator().id);
+	EXPECT_EQ(1, y.get_allocator().id);
+	EXPECT_EQ(10, x.size());
+	EXPECT_EQ(300, y.size());
+}